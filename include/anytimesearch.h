@@ -0,0 +1,144 @@
+#ifndef ANYTIMESEARCH_H
+#define ANYTIMESEARCH_H
+
+#include "level.h"
+#include "state.h"
+#include "transpositiontable.h"
+#include "nodepool.h"
+#include <set>
+#include <vector>
+#include <sys/time.h>
+
+/**
+ * Anytime repairing A* (ARA*), for when a solution soon matters more than the cheapest one
+ * States are expanded by g + w*h, starting with a large weight w that heads straight for the goals.
+ * Each round stops once nothing open is cheaper than the best solution by that order, and the next
+ * one lowers w and carries on with the same states. States made cheaper after they were expanded
+ * this round wait in a list of their own for the next round, instead of being expanded again.
+ * A solution's cost over the smallest g + h left open or waiting bounds how far from the
+ * cheapest it can be. It stops at a time or state budget, or once w is 1 and the round is done
+ */
+class AnytimeSearch
+{
+    public:
+        /**
+         * Inits a search
+         *@param level the loaded level
+         *@param msec how long it may search, 0 for no limit
+         *@param limit how many states it may expand, 0 for no limit
+         */
+        AnytimeSearch(Level& level, int msec, int limit);
+
+        /**
+         * Searches until a cheaper solution is found, or the one found last is proven closer to the cheapest
+         *@return the best goal state so far, NULL once there's nothing better to find or the budget ran out.
+         * It lives as long as the search
+         */
+        State* improve();
+
+        /**
+         * Returns how far the best solution can be from the cheapest one
+         *@return at most how many times the cheapest solution's cost it takes, 0 if it isn't known yet
+         */
+        double getBound();
+
+        /**
+         * Returns whether or not the search stopped because the budget ran out
+         *@return true if there might be something better left to find
+         */
+        bool isOutOfBudget();
+
+        /**
+         * Returns how many states were expanded, over all rounds
+         *@return states
+         */
+        int getStates();
+
+        /**
+         * Returns how long the search has been going
+         *@return milliseconds
+         */
+        float getMsec();
+
+    private:
+        /**
+         * What a state needs for ARA*, kept after it in the pool
+         */
+        struct Memo {
+            int round; /**< the round it was last expanded in, 0 if never */
+            bool open; /**< whether or not it's in the open list */
+            bool waiting; /**< whether or not it's waiting for the next round */
+        };
+
+        /**
+         * An open list entry, best first
+         */
+        struct Open {
+            double f; /**< g + w*h */
+            int h; /**< its heuristic, smaller goes first on equal f */
+            State* state; /**< the state */
+
+            /**
+             * Orders entries best first
+             *@param other the other entry
+             *@return true if this one goes first
+             */
+            bool operator<(const Open& other) const;
+        };
+
+        /**
+         * Expands states until nothing open is cheaper than the best solution, or the budget runs out
+         *@return true if the round was finished
+         */
+        bool search();
+
+        /**
+         * Keeps a child, unless it's a position already reached at no more cost
+         *@param child the new child
+         */
+        void add(State* child);
+
+        /**
+         * Puts a state in the open list
+         *@param state the state
+         */
+        void queue(State* state);
+
+        /**
+         * Works out the bound of the best solution
+         *@param finished whether or not the round was finished, so the weight bounds it too
+         */
+        void findBound(bool finished);
+
+        /**
+         * Returns whether or not the time or state budget is used up
+         *@return true if the search has to stop
+         */
+        bool isOverBudget();
+
+        /**
+         * Returns a state's ARA* data
+         *@param state the state
+         *@return memo
+         */
+        Memo* memo(State* state);
+
+        Level& level; /**< the level being solved */
+        unsigned int offset; /**< where the memo starts after a state */
+        NodePool pool; /**< every state built, states made cheaper stay as their children's parents */
+        TranspositionTable nodes; /**< the cheapest copy of every position reached */
+        std::set<Open> open; /**< states to expand this round, best first */
+        std::vector<State *> waiting; /**< states made cheaper after they were expanded this round */
+        double weight; /**< w, how much h counts */
+        int round; /**< the current round, from 1 */
+        State* best; /**< the cheapest goal state found, NULL if none yet */
+        double bound; /**< how far the best solution can be from the cheapest, 0 if not known */
+        bool done; /**< whether or not there's nothing left to improve */
+        bool outOfBudget; /**< whether or not it stopped on the budget */
+        int msec; /**< how long it may search, 0 for no limit */
+        int limit; /**< how many states it may expand, 0 for no limit */
+        int states; /**< how many states were expanded */
+        struct timeval start; /**< when the search started */
+};
+
+#endif // ANYTIMESEARCH_H
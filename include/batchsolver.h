@@ -0,0 +1,121 @@
+#ifndef BATCHSOLVER_H
+#define BATCHSOLVER_H
+
+#include "deadlockpatterns.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <pthread.h>
+
+/**
+ * Solves a whole collection of levels, or a directory of level files, on a pool of threads
+ * Every thread starts with its share of the levels and steals from the others once it runs out,
+ * so one hard level only holds up the thread solving it. Each level is searched on one thread,
+ * and the deadlock patterns learned are shared between levels and saved once at the end, if there's a pattern file
+ */
+class BatchSolver
+{
+    public:
+        /**
+         * Inits a batch
+         *@param threads how many levels to solve at once
+         */
+        BatchSolver(int threads);
+
+        /**
+         * Frees the threads' queues
+         */
+        ~BatchSolver();
+
+        /**
+         * Sets a file to load deadlock patterns from before solving, and to save the ones learned to after
+         *@param _patternFile the file, empty to neither load nor save patterns
+         */
+        void setPatternFile(std::string& _patternFile);
+
+        /**
+         * Sets a budget for each level, searching them with ARA* and taking the best solution found within it
+         *@param _msec how long a level may take, 0 for no limit
+         *@param _states how many states a level may expand, 0 for no limit. Both 0 searches with A*
+         */
+        void setBudget(int _msec, int _states);
+
+        /**
+         * Reads the levels of a collection file, or of every file in a directory
+         *@param path the file or directory
+         *@return true if at least one level was found
+         */
+        bool load(char* path);
+
+        /**
+         * Solves every level, printing a row for each as it finishes and the totals at the end
+         *@return how many levels were solved
+         */
+        int solve();
+
+    private:
+        /**
+         * Everything one thread works with
+         */
+        struct Worker {
+            BatchSolver* batch; /**< the batch this thread belongs to */
+            int id; /**< which thread this is */
+            std::deque<int> levels; /**< the levels this thread still has to solve */
+            pthread_mutex_t lock; /**< guards levels, other threads steal from it */
+            pthread_t thread; /**< the thread itself */
+        };
+
+        /**
+         * Splits a collection file into its levels
+         *@param file the file
+         *@param name what to call its levels
+         *@return how many levels it had
+         */
+        int loadFile(const char* file, std::string name);
+
+        /**
+         * Returns whether or not a line of a collection file is a map row, rather than a title or comment
+         *@param line the line, map rows may use - or _ for floor
+         *@return true if it's part of a map
+         */
+        bool isMapRow(std::string& line);
+
+        /**
+         * Thread entry point
+         *@param worker the thread's worker
+         *@return NULL
+         */
+        static void* start(void* worker);
+
+        /**
+         * Solves levels until there are none left anywhere
+         *@param worker the thread's worker
+         */
+        void run(Worker* worker);
+
+        /**
+         * Takes the next level off a thread's own queue, or steals one from the fullest other queue
+         *@param worker the thread's worker
+         *@param level (out) the level taken
+         *@return false if every queue is empty
+         */
+        bool take(Worker* worker, int* level);
+
+        /**
+         * Solves one level and prints its row
+         *@param level the level
+         */
+        void solveLevel(int level);
+
+        std::vector<std::string> names; /**< each level's name */
+        std::vector<std::string> maps; /**< each level's map */
+        std::vector<Worker *> workers; /**< one per thread */
+        DeadlockPatterns patterns; /**< the patterns shared by every level */
+        std::string patternFile; /**< where the patterns are kept between runs, empty for nowhere */
+        pthread_mutex_t lock; /**< guards patterns, the totals and the output */
+        int solved; /**< how many levels were solved */
+        int budgetMsec; /**< how long each level may take, 0 for no limit */
+        int budgetStates; /**< how many states each level may expand, 0 for no limit */
+};
+
+#endif // BATCHSOLVER_H
@@ -0,0 +1,100 @@
+#ifndef BIDIRECTIONALSEARCH_H
+#define BIDIRECTIONALSEARCH_H
+
+#include "level.h"
+#include "state.h"
+#include "openlist.h"
+#include "pushqueue.h"
+#include "transpositiontable.h"
+#include "nodepool.h"
+#include <vector>
+
+/**
+ * A* from the start pushing blocks, and from the goals pulling them, at the same time
+ * The backward search starts from every region the robot can be in with the blocks on the goals,
+ * and is guided by a matching back to the cells the blocks started on. Both searches keep their
+ * states in one table, so a state built by one that the other already has joins them into a solution.
+ * The first meeting is taken, so the solution is not always the cheapest one
+ */
+class BidirectionalSearch
+{
+    public:
+        /**
+         * Inits a search
+         *@param level the loaded level, without spare blocks
+         */
+        BidirectionalSearch(Level& level);
+
+        /**
+         * Searches until the two searches meet, or either runs out of states
+         *@return true if a solution was found
+         */
+        bool solve();
+
+        /**
+         * Returns where the forward half of the solution ends
+         *@return the forward state, it lives as long as the search
+         */
+        State* getForward();
+
+        /**
+         * Returns where the backward half of the solution starts, the same position as the forward state
+         *@return the backward state, NULL if the forward search reached the goals on its own
+         */
+        State* getBackward();
+
+        /**
+         * Returns how many states were expanded, both ways
+         *@return states
+         */
+        int getStates();
+
+    private:
+        /**
+         * One direction's search
+         */
+        struct Side {
+            Level* level; /**< the level its states are built on */
+            OpenList openlist; /**< the states it still has to expand */
+            PushQueue pushes; /**< the pushes (or pulls) it still has to build */
+        };
+
+        /**
+         * Builds the states the backward search starts from, one per robot region around the goals
+         */
+        void startBackward();
+
+        /**
+         * Adds a built state to the table and its side's open list, unless it's a duplicate
+         * or it meets a state of the other side
+         *@param side the side that built it
+         *@param state the state
+         */
+        void add(Side& side, State* state);
+
+        /**
+         * Builds a push or expands a state, whichever is better
+         *@param side the side to step
+         */
+        void step(Side& side);
+
+        /**
+         * Returns how much a side still has to do
+         *@param side the side
+         *@return its open states and unbuilt pushes
+         */
+        unsigned int size(Side& side);
+
+        Level& level; /**< the level being solved */
+        Level reverse; /**< the level turned around for the backward search */
+        NodePool pool; /**< every state of both searches */
+        TranspositionTable nodes; /**< every state of both searches, where they meet */
+        Side forward; /**< the search from the start */
+        Side backward; /**< the search from the goals */
+        std::vector<PushQueue::Push> children; /**< scratch for the pushes of an expanded state */
+        State* meetForward; /**< the forward state of the solution, NULL until there is one */
+        State* meetBackward; /**< the backward state it met */
+        int states; /**< how many states were expanded */
+};
+
+#endif // BIDIRECTIONALSEARCH_H
@@ -9,6 +9,18 @@
 #define BLOCK_ON_GOAL '*'
 #define ROBOT_ON_GOAL '+'
 
+#define DEAD_END 0x3fffffff /**< h of a state that can never be solved */
+#define NO_DISTANCE 0xffff /**< push distance to a goal a block can't reach */
+#define MAX_CELLS 65535 /**< the most cells a map can have, states keep block cells in 16 bits */
+
+#define COST_SWITCHES     0 /**< a push costs 1, or as many as there are blocks when it's a different block */
+#define COST_PUSHES       1 /**< the fewest pushes */
+#define COST_PUSHES_MOVES 2 /**< the fewest pushes, then the fewest moves */
+#define COST_MOVES_PUSHES 3 /**< the fewest moves, then the fewest pushes */
+#define LEX_SCALE 32768 /**< what one of the first count is worth in the second, when a cost counts both.
+                            The order only holds while the second count stays under it, and the first under DEAD_END/LEX_SCALE */
+
+
 #define UP      0
 #define DOWN    1
 #define LEFT    2
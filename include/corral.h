@@ -0,0 +1,87 @@
+#ifndef CORRAL_H
+#define CORRAL_H
+
+#include <vector>
+
+class Level;
+class State;
+
+/**
+ * Finds PI-corrals: areas the robot can't reach whose blocks can only be pushed into them,
+ * each of those pushes being possible right now.
+ * Some push into an unsolved PI-corral has to happen first, so the others can be skipped,
+ * and a corral that can't be solved even on its own proves the state deadlocked
+ */
+class Corral
+{
+    public:
+        /**
+         * Inits an empty corral finder
+         */
+        Corral();
+
+        /**
+         * Sizes the grids for a level
+         *@param cells how many cells the level has
+         */
+        void resize(int cells);
+
+        /**
+         * Looks for the unsolved PI-corral with the fewest pushes
+         * The blocks must be placed in the workspace and the robot region must be the reached cells
+         *@param level the level the state is in
+         *@param blocks the cells holding blocks
+         *@param count how many blocks there are
+         *@param pushable (in/out) the pushes per block, cut down to the corral's pushes if one is found
+         *@return how many pushes into the corral there are, -1 if there is no PI-corral
+         */
+        int find(Level& level, unsigned short* blocks, unsigned int count, unsigned char* pushable);
+
+        /**
+         * Tries to solve the last corral found with only its own blocks on the board
+         *@param level the level
+         *@param robot a cell the robot can reach
+         *@return true if it can't be done, so the state is deadlocked
+         */
+        bool isDeadlocked(Level& level, int robot);
+
+    private:
+        /**
+         * Labels the area of unreachable cells connected to a cell
+         *@param level the level
+         *@param index the first cell
+         *@param id the label to give the area
+         */
+        void label(Level& level, int index, int id);
+
+        /**
+         * Returns whether or not a cell is in an area
+         *@param index the cell
+         *@param id the area's label
+         *@return true if the cell has this label
+         */
+        bool inArea(int index, int id);
+
+        /**
+         * Returns whether or not a state of the sub search has resolved the corral,
+         * either with every block on a goal or the robot getting inside it
+         *@param level the level
+         *@param state the sub search state
+         *@return true if the corral can't be proven deadlocked from here
+         */
+        bool isResolved(Level& level, State* state);
+
+        std::vector<int> areas; /**< the area label of each cell */
+        std::vector<unsigned int> stamps; /**< the stamp each label was written with */
+        unsigned int stamp; /**< the stamp of the current search for corrals */
+        std::vector<int> blockArea; /**< the last area each block was added to */
+        std::vector<int> cells; /**< the cells of the area labelled last */
+        std::vector<int> around; /**< the blocks around the area labelled last */
+
+        int corralId; /**< the label of the chosen corral */
+        std::vector<int> corralCells; /**< the area of the chosen corral */
+        std::vector<int> corralBlocks; /**< the blocks around the chosen corral */
+        bool searching; /**< set while the sub search runs, it doesn't look for corrals itself */
+};
+
+#endif // CORRAL_H
@@ -0,0 +1,169 @@
+#ifndef DEADLOCKPATTERNS_H
+#define DEADLOCKPATTERNS_H
+
+#include <vector>
+#include <set>
+#include <stdint.h>
+
+class Level;
+
+/**
+ * Remembers small deadlocked neighbourhoods so they're pruned with a single lookup,
+ * and keeps them in a file so later runs start out knowing them.
+ * A pattern is the 5x5 window of walls, goals and blocks around a pushed block, a base 5 digit a cell,
+ * and the part of it the robot can get to. Windows come from PI-corrals the corral sub search proved
+ * deadlocked. One is only kept if a search inside the window proves it again, with everything outside
+ * it free floor that a block can leave to. So a pattern is deadlocked wherever it shows up in any level
+ */
+class DeadlockPatterns
+{
+    public:
+        /**
+         * Inits an empty pattern store
+         */
+        DeadlockPatterns();
+
+        /**
+         * Reads patterns saved by an earlier run
+         *@param file the file to read
+         *@return how many patterns were read, 0 if the file is missing or not a pattern file
+         */
+        int load(const char* file);
+
+        /**
+         * Writes every known pattern to a file, if any were learned since loading
+         *@param file the file to write
+         *@return true on success, or if there was nothing new to write
+         */
+        bool save(const char* file);
+
+        /**
+         * Encodes the window around a cell, the blocks must be placed in the workspace
+         *@param level the level
+         *@param index the centre cell
+         *@param robot any cell the robot can walk to
+         *@return the window
+         */
+        uint64_t encode(Level& level, int index, int robot);
+
+        /**
+         * Returns whether or not a window is a known deadlock
+         *@param window the encoded window
+         *@return true if it can never be solved
+         */
+        bool contains(uint64_t window);
+
+        /**
+         * Keeps a window a corral sub search found deadlocked, if it's deadlocked without the rest of its level
+         *@param window the encoded window
+         *@return true if it was added
+         */
+        bool learn(uint64_t window);
+
+        /**
+         * Takes in the patterns another store learned
+         *@param other the other store
+         *@return how many were new here
+         */
+        int merge(DeadlockPatterns& other);
+
+        /**
+         * Returns how many patterns are known
+         *@return the number of distinct patterns, not counting rotations and mirrors
+         */
+        int size();
+
+        /**
+         * Returns how many patterns were learned since loading
+         *@return learned
+         */
+        int getLearned();
+
+    private:
+        /**
+         * Returns a window turned or mirrored
+         *@param window the encoded window
+         *@param symmetry which of the 8 symmetries
+         *@return the transformed window
+         */
+        uint64_t transform(uint64_t window, int symmetry);
+
+        /**
+         * Adds a pattern and its rotations and mirrors to the lookup table
+         *@param window the encoded window
+         */
+        void add(uint64_t window);
+
+        /**
+         * Puts a window in the lookup table, growing it once it's half full
+         *@param window the encoded window, not already in the table
+         */
+        void insert(uint64_t window);
+
+        /**
+         * Returns the table slot a window's probe starts at
+         *@param window the encoded window
+         *@return the slot
+         */
+        unsigned int slot(uint64_t window);
+
+        /**
+         * Returns whether or not a window can never get its blocks onto goals or out of it,
+         * with the cells outside the window free floor
+         *@param window the encoded window
+         *@return true if the window is deadlocked in any level, false if not or the search gave up
+         */
+        bool isDeadlocked(uint64_t window);
+
+        /**
+         * Splits a window into its cells
+         *@param window the encoded window
+         *@param cells (out) WINDOW*WINDOW cell codes
+         *@return the robot's area, the lowest cell in it or OUTSIDE
+         */
+        int decode(uint64_t window, unsigned char* cells);
+
+        /**
+         * Joins cells into a window
+         *@param cells WINDOW*WINDOW cell codes
+         *@param robot a cell the robot can walk to, OUTSIDE if it's not in the window
+         *@return the encoded window
+         */
+        uint64_t pack(unsigned char* cells, int robot);
+
+        /**
+         * Returns the robot's area in the window, going round outside it where the window's edges are free
+         *@param walls a bit per wall cell
+         *@param blocks a bit per block cell
+         *@param robot the robot's cell, OUTSIDE for around the window
+         *@return the lowest cell it can walk to, or OUTSIDE if it can get out of the window
+         */
+        int area(uint32_t walls, uint32_t blocks, int robot);
+
+        /**
+         * Returns the window cell next to another one
+         *@param cell the cell, OUTSIDE for anywhere around the window
+         *@param direction the direction to step
+         *@return the cell, OUTSIDE when it leaves the window
+         */
+        int step(int cell, int direction);
+
+        /**
+         * Finds the window cells the robot can walk to
+         *@param walls a bit per wall cell
+         *@param blocks a bit per block cell
+         *@param start the robot's cell, OUTSIDE for around the window
+         *@param outside (out) whether or not it can get out of the window
+         *@return a bit per reached cell
+         */
+        uint32_t reach(uint32_t walls, uint32_t blocks, int start, bool* outside);
+
+        std::vector<uint64_t> table; /**< open addressed set of every symmetry of every pattern, 0 is empty */
+        unsigned int used; /**< how many table slots are taken */
+        std::vector<uint64_t> patterns; /**< one copy of each pattern, what gets saved */
+        int learned; /**< patterns added since loading */
+        std::set<uint64_t> rejected; /**< windows the window search couldn't prove, not tried again */
+        int symmetries[8][25]; /**< for each symmetry, which window cell lands on each cell */
+};
+
+#endif // DEADLOCKPATTERNS_H
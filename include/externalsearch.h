@@ -0,0 +1,170 @@
+#ifndef EXTERNALSEARCH_H
+#define EXTERNALSEARCH_H
+
+#include "level.h"
+#include "state.h"
+#include "nodepool.h"
+#include "runfile.h"
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * External memory A* with delayed duplicate detection, for levels with more states than fit in RAM
+ * States live in files, in buckets of the same g and h. A bucket is a set of sorted runs,
+ * written whenever the buffered children get too big. Buckets are expanded cheapest f first,
+ * then smallest g. Its runs are merged to drop duplicates, and then merged against the expanded
+ * buckets with the same h, since a position always has the same h, to drop what was already
+ * reached for no more. What's left is the bucket's closed run, and gets expanded.
+ * Each state on disk remembers the hash of its parent and the bucket it was in, the path is found back through them
+ */
+class ExternalSearch
+{
+    public:
+        /**
+         * Inits a search
+         *@param level the loaded level
+         *@param directory where to keep the files, it must exist
+         */
+        ExternalSearch(Level& level, std::string& directory);
+
+        /**
+         * Deletes the files the search made
+         */
+        ~ExternalSearch();
+
+        /**
+         * Searches until the cheapest solution is found or the level is proven to have none
+         *@return the goal state, NULL if there's no solution or the files couldn't be used.
+         * It lives as long as the search
+         */
+        State* solve();
+
+        /**
+         * Returns whether or not the search stopped because the files couldn't be used
+         *@return true on a file error
+         */
+        bool hasFailed();
+
+        /**
+         * Returns how many states were expanded
+         *@return states
+         */
+        int getStates();
+
+    private:
+        /**
+         * What a state carries along on disk, after its key
+         */
+        struct Data {
+            int g; /**< the cost it was reached with */
+            int moved; /**< the cell of the block pushed last, -1 for the start state */
+            uint64_t parent; /**< the hash of its parent, 0 for the start state */
+            int parentG; /**< the g of its parent's bucket */
+            int parentH; /**< the h of its parent's bucket */
+        };
+
+        /**
+         * States of the same g and h waiting to be expanded
+         */
+        struct Bucket {
+            std::vector<unsigned char> buffer; /**< records not written out yet */
+            std::vector<std::string> runs; /**< the sorted runs written so far */
+        };
+
+        /**
+         * An expanded bucket's run
+         */
+        struct Closed {
+            int g; /**< the g of its states */
+            std::string path; /**< its file */
+        };
+
+        /**
+         * Orders buffered records by key
+         */
+        struct KeyOrder {
+            unsigned int bytes; /**< how big a key is */
+
+            /**
+             * Compares the keys of two records
+             *@param a a record
+             *@param b another record
+             *@return true if a's key goes first
+             */
+            bool operator()(unsigned char* a, unsigned char* b) const;
+        };
+
+        /**
+         * Adds a state to its bucket, writing buckets out when too much is buffered
+         *@param state the state
+         *@param parent the state it was pushed from, NULL for none
+         */
+        void add(State* state, State* parent);
+
+        /**
+         * Writes a bucket's buffered records out as a sorted run
+         *@param bucket the bucket
+         */
+        void flush(Bucket& bucket);
+
+        /**
+         * Merges a bucket's runs, drops what was already expanded and expands the rest
+         *@param g the bucket's g
+         *@param h the bucket's h
+         *@param bucket the bucket, it's been taken out of the open buckets
+         *@param goal (out) the goal record, if the bucket had one
+         *@return true if a goal was found
+         */
+        bool expand(int g, int h, Bucket& bucket, std::vector<unsigned char>* goal);
+
+        /**
+         * Builds the state a record holds
+         *@param record the record
+         *@return the state, in the pool
+         */
+        State* rebuild(unsigned char* record);
+
+        /**
+         * Finds the path to a goal record back through the parents' buckets, and builds it in the pool
+         *@param goal the goal record
+         *@return the goal state, with its parents up to the start state
+         */
+        State* buildPath(unsigned char* goal);
+
+        /**
+         * Writes a state's key: its block cells and its robot region
+         *@param state the state
+         *@param key (out) where to write it
+         */
+        void encode(State* state, unsigned char* key);
+
+        /**
+         * Returns the hash of the state a key belongs to
+         *@param key the key
+         *@return hash
+         */
+        uint64_t hashOf(unsigned char* key);
+
+        /**
+         * Makes a new file in the directory, named so no other search can pick it too
+         *@return path, empty if it couldn't be made
+         */
+        std::string newPath();
+
+        Level& level; /**< the level being solved */
+        std::string directory; /**< where the files go */
+        unsigned int blocks; /**< how many blocks there are */
+        unsigned int keyBytes; /**< how big a key is */
+        unsigned int recordBytes; /**< how big a key and its data are */
+        NodePool pool; /**< the states being expanded, and the solution path */
+        std::map<std::pair<int, int>, Bucket> open; /**< the buckets to expand by f, then g */
+        std::map<int, std::vector<Closed> > closed; /**< the expanded runs by h */
+        std::vector<std::string> files; /**< every file made, to delete at the end */
+        size_t buffered; /**< how many bytes the buckets have buffered */
+        bool failed; /**< whether or not a file couldn't be used */
+        int states; /**< how many states were expanded */
+};
+
+#endif // EXTERNALSEARCH_H
@@ -0,0 +1,93 @@
+#ifndef IDASEARCH_H
+#define IDASEARCH_H
+
+#include "level.h"
+#include "state.h"
+#include "nodepool.h"
+#include <vector>
+#include <stdint.h>
+
+/**
+ * Iterative deepening A* (IDA*), for levels that don't fit in memory with A*
+ * Each iteration is a depth first search cut off at an f bound, which grows to the smallest f
+ * that went over it. Only the states on the current path and their siblings are kept, and a
+ * transposition table of a fixed size remembers the cheapest g each position was reached with
+ * this iteration, so paths that reach a position no cheaper aren't searched again. An entry keeps
+ * a second hash of the position, worked out another way, so two positions sharing a hash aren't mixed up.
+ * The position was searched from with at least as much of the bound left the first time,
+ * so nothing is lost and the first solution found is still the cheapest one
+ */
+class IdaSearch
+{
+    public:
+        /**
+         * Inits a search
+         *@param level the loaded level
+         *@param megabytes how big the transposition table is
+         */
+        IdaSearch(Level& level, unsigned int megabytes);
+
+        /**
+         * Deepens until a solution is found or the level is proven to have none
+         *@return the goal state, NULL if the level has no solution. It lives as long as the search
+         */
+        State* solve();
+
+        /**
+         * Returns how many states were expanded, over all iterations
+         *@return states
+         */
+        int getStates();
+
+    private:
+        /**
+         * A transposition table slot
+         */
+        struct Entry {
+            uint64_t hash; /**< the position's zobrist hash */
+            uint64_t check; /**< the position's second hash, a hit has to match both */
+            int g; /**< the cheapest g it was reached with */
+            int iteration; /**< the iteration that was in, entries of older ones are stale */
+        };
+
+        /**
+         * Searches below a state, as long as f stays within the bound
+         *@param state the state
+         *@param bound the f bound of this iteration
+         *@param next (in/out) the smallest f over the bound so far
+         *@return the goal state, NULL if there's none within the bound
+         */
+        State* search(State* state, int bound, int* next);
+
+        /**
+         * Returns whether or not a position was already reached this iteration at no more cost,
+         * remembering it otherwise
+         *@param state the state
+         *@return true if the state needn't be searched again
+         */
+        bool isKnown(State* state);
+
+        /**
+         * Returns a hash of a state's position independent of its zobrist hash, to check table hits with
+         *@param state the state
+         *@return hash
+         */
+        uint64_t checkOf(State* state);
+
+        /**
+         * Orders children cheapest f first, then closest to the goals
+         *@param a a child
+         *@param b another child
+         *@return true if a goes first
+         */
+        static bool better(State* a, State* b);
+
+        Level& level; /**< the level being solved */
+        NodePool pool; /**< the states on the current path and their siblings */
+        std::vector<Entry> table; /**< buckets of 2 entries */
+        size_t buckets; /**< how many buckets there are */
+        int iteration; /**< the current iteration, from 1 */
+        int states; /**< how many states were expanded */
+};
+
+#endif // IDASEARCH_H
@@ -0,0 +1,51 @@
+#ifndef INBOX_H
+#define INBOX_H
+
+#include "pushqueue.h"
+
+#define INBOX_BATCH 128 /**< pushes sent together in one message */
+
+/**
+ * Lock-free queue of pushes sent to one search thread, any thread can send, only the owner receives
+ * Senders link batches onto a stack with compare and swap, and the owner takes the whole stack at once,
+ * so there is no ABA problem. Order doesn't matter, everything received goes into a heap anyway
+ */
+class Inbox
+{
+    public:
+        /**
+         * A batch of pushes in one message
+         */
+        struct Batch {
+            Batch* next; /**< the batch sent before this one */
+            unsigned int count; /**< how many pushes are in it */
+            PushQueue::Push pushes[INBOX_BATCH]; /**< the pushes */
+        };
+
+        /**
+         * Inits an empty inbox
+         */
+        Inbox();
+
+        /**
+         * Frees any batches never received
+         */
+        ~Inbox();
+
+        /**
+         * Sends a batch, the inbox owns it from now on
+         *@param batch the batch
+         */
+        void send(Batch* batch);
+
+        /**
+         * Takes every batch sent so far, the caller owns them from now on
+         *@return the batches linked through next, NULL if there are none
+         */
+        Batch* receive();
+
+    private:
+        Batch* head; /**< the last batch sent, only ever touched atomically */
+};
+
+#endif // INBOX_H
@@ -4,11 +4,16 @@
 #include "robot.h"
 #include "goal.h"
 #include "block.h"
+#include "workspace.h"
+#include "corral.h"
+#include "deadlockpatterns.h"
+#include "matching.h"
 #include <vector>
 #include <string>
-#include <map>
+#include <stdint.h>
 
 class State;
+class NodePool;
 
 /**
  * A Sokoban level
@@ -21,6 +26,12 @@ class Level
          */
         Level();
 
+        /**
+         * Copies a loaded level, with scratch space of its own so both can build states at once
+         *@param other the level to copy
+         */
+        Level(const Level& other);
+
         /**
          * Clears memory used by the level
          */
@@ -33,6 +44,20 @@ class Level
          */
         bool load(char* file);
 
+        /**
+         * Loads a level from its map, one row per line
+         *@param mapstr the map
+         *@return true on success, false on failure
+         */
+        bool parse(std::string& mapstr);
+
+        /**
+         * Turns this copy of a level around, for a search pulling blocks back from the goals
+         * The cells the blocks start on become the goals and the goals hold the blocks,
+         * so push distances become the pulls back to where the blocks started
+         */
+        void reverse();
+
         /**
          * Returns the map width
          *@return width
@@ -64,10 +89,11 @@ class Level
         std::vector<Block *>& getBlocks();
 
         /**
-         * Returns the starting state
-         *@return start
+         * Builds the starting state
+         *@param pool the pool the search keeps its states in
+         *@return the start state
          */
-        State* getStart();
+        State* getStart(NodePool& pool);
 
         /**
          * Returns the wall map
@@ -75,6 +101,177 @@ class Level
          */
         std::string& getWallMap();
 
+        /**
+         * Returns the zobrist hash of a block sitting on a cell
+         *@param index the cell
+         *@return the hash
+         */
+        uint64_t getBlockHash(int index);
+
+        /**
+         * Returns the zobrist hash of the robot region with this lowest cell
+         *@param index the lowest cell the robot can reach
+         *@return the hash
+         */
+        uint64_t getRobotHash(int index);
+
+        /**
+         * Returns the goal on a cell
+         *@param index the cell
+         *@return the goal, -1 if the cell isn't a goal
+         */
+        int getGoalAt(int index);
+
+        /**
+         * Returns the block currently on a cell
+         *@param index the cell
+         *@return the block, -1 if there is none
+         */
+        int getBlockAt(int index);
+
+        /**
+         * Returns whether or not there are more blocks than goals
+         * Spare blocks can stay anywhere, so deadlocks only count when there are none
+         *@return true if some blocks never need to reach a goal
+         */
+        bool hasSpareBlocks();
+
+        /**
+         * Returns whether or not a block on this cell can never reach a goal
+         *@param index the cell
+         *@return true if pushing a block here loses the level
+         */
+        bool isDead(int index);
+
+        /**
+         * Returns whether or not a block pushed onto a cell is in a tunnel, where the robot
+         * can only push it on or walk back out, and the cell it goes to next is still in the tunnel
+         *@param index the cell
+         *@param direction the direction the block was pushed
+         *@return true if the block should be pushed on in the same push
+         */
+        bool isTunnel(int index, int direction);
+
+        /**
+         * Looks for a room holding every goal with a single entrance, and an order to fill its goals in,
+         * found backwards from the full room by taking out blocks that can still be pushed back out
+         * Blocks pushed onto the entrance then go straight to the next goal in that order
+         */
+        void findGoalRoom();
+
+        /**
+         * Returns the cell blocks get into the goal room from
+         *@return the entrance, -1 if there's no goal room
+         */
+        int getRoomEntrance();
+
+        /**
+         * Returns the direction a block is pushed from the entrance into the goal room
+         *@return the direction
+         */
+        int getRoomEntry();
+
+        /**
+         * Returns how far the goal room is filled, if it holds just the first goals of the packing order
+         *@param cells the cells holding blocks
+         *@param count how many there are
+         *@return how many goals are filled, -1 if any other block is in the room
+         */
+        int getPackedCount(unsigned short* cells, int count);
+
+        /**
+         * Returns how many goals the packing order has
+         *@return the goals in the goal room
+         */
+        int getPackingSize();
+
+        /**
+         * Returns the goal filled at a step of the packing order
+         *@param step the step
+         *@return the goal's cell
+         */
+        int getPackingGoal(int step);
+
+        /**
+         * Returns the step of the packing order a goal is filled at
+         *@param index the goal's cell
+         *@return the step, -1 if the goal isn't in the goal room
+         */
+        int getPackingStep(int index);
+
+        /**
+         * Returns the cells a block is pushed from, from the entrance onto a step's goal
+         *@param step the step
+         *@return a cell per push
+         */
+        std::vector<int>& getPackingCells(int step);
+
+        /**
+         * Returns the directions a block is pushed, from the entrance onto a step's goal
+         *@param step the step
+         *@return a direction per push
+         */
+        std::vector<int>& getPackingDirections(int step);
+
+        /**
+         * Returns how many steps the robot walks between the pushes that fill a step's goal
+         *@param step the step
+         *@return the moves that aren't pushes
+         */
+        int getPackingWalk(int step);
+
+        /**
+         * Returns the fewest pushes that get a lone block from a cell onto each goal, in goal order
+         *@param index the cell
+         *@return one distance per goal, NO_DISTANCE if the block can't get there
+         */
+        unsigned short* getPushDistances(int index);
+
+        /**
+         * Returns the cell next to another one
+         *@param index the cell
+         *@param direction which neighbour
+         *@return the neighbouring cell, -1 if it's a wall or off the map
+         */
+        int neighbour(int index, int direction);
+
+        /**
+         * Returns how many cells aren't walls
+         *@return the number of floor cells
+         */
+        int getFloorCount();
+
+        /**
+         * Returns the dense number of a floor cell, floor cells are numbered 0 to getFloorCount()-1
+         *@param index the cell
+         *@return the floor number, -1 for walls
+         */
+        int getFloorIndex(int index);
+
+        /**
+         * Returns the scratch grids states use while they're being built
+         *@return workspace
+         */
+        Workspace& getWorkspace();
+
+        /**
+         * Returns the corral finder states use while they're being built
+         *@return corral
+         */
+        Corral& getCorral();
+
+        /**
+         * Returns the deadlock patterns known so far
+         *@return patterns
+         */
+        DeadlockPatterns& getPatterns();
+
+        /**
+         * Returns the block to goal matcher states use to evaluate themselves
+         *@return matching
+         */
+        Matching& getMatching();
+
         /**
          * Determines the path the robot would need to take to push the block
          *@param block which block to push
@@ -99,32 +296,155 @@ class Level
          */
         int getRobotStatesExpanded();
 
+        /**
+         * Sets what a solution's cost counts, before any state is built
+         *@param model COST_SWITCHES, COST_PUSHES, COST_PUSHES_MOVES or COST_MOVES_PUSHES
+         */
+        void setCostModel(int model);
+
+        /**
+         * Returns what a solution's cost counts
+         *@return the cost model
+         */
+        int getCostModel();
+
+        /**
+         * Returns whether or not the cost counts the robot's moves, so states need its exact cell
+         *@return true for COST_PUSHES_MOVES and COST_MOVES_PUSHES
+         */
+        bool countsMoves();
+
+        /**
+         * Returns what some pushes and moves cost, the moves include the pushes
+         * Without moves in the cost it's just the pushes, block switches are up to the state
+         *@param pushes the pushes
+         *@param moves the moves
+         *@return the cost
+         */
+        int getCost(int pushes, int moves);
+
+        /**
+         * Returns whether or not getCost ranks some pushes and moves exactly
+         * Past LEX_SCALE the second count carries into the first, and past DEAD_END/LEX_SCALE the first runs into DEAD_END
+         *@param pushes the pushes
+         *@param moves the moves
+         *@return true if the cost doesn't count both, or both are within the limits
+         */
+        bool isCostExact(int pushes, int moves);
+
+        /**
+         * Returns the heuristic for a lower bound on the pushes left, every push being a move too
+         *@param pushes the pushes left at least
+         *@return h in the cost model
+         */
+        int getHeuristic(int pushes);
+
+        /**
+         * Returns the pushes a heuristic was worked out from
+         *@param h a heuristic from getHeuristic
+         *@return the pushes left at least
+         */
+        int getHeuristicPushes(int h);
+
+        /**
+         * Returns how many steps the robot walks from its cell in a state to another cell, around the state's blocks
+         * The walks are searched once per state, and kept until a different state asks
+         *@param state the state, its region is the robot's cell when moves are counted
+         *@param index the cell to walk to
+         *@return the steps, -1 if the robot can't get there
+         */
+        int getWalk(State* state, int index);
+
     private:
         /**
-         * Grabs the best guess from the openset
-         *@param openset the open set
-         *@return the bets guess of where to go next
+         * Numbers the floor cells and builds the neighbour table, so moving around the map
+         * is a table lookup instead of index arithmetic and wall checks
+         */
+        void indexFloor();
+
+        /**
+         * Works out the push distance from every cell to every goal
+         * Pulling a block away from a goal, breadth first, reaches each cell with the fewest pulls,
+         * which is the fewest pushes back, ignoring where the robot has to walk.
+         * A reversed level pushes away from its goals instead, giving the fewest pulls back
+         */
+        void findPushDistances();
+
+        /**
+         * Marks the cells a block can never be pushed from onto a goal,
+         * the ones no goal has a push distance from
+         */
+        void findDeadSquares();
+
+        /**
+         * Marks the cells a block is pushed on through, for each direction it can come in from:
+         * cells off goals in one wide corridors, with the robot's cell behind them and the next cell
+         * in the corridor too
+         */
+        void findTunnels();
+
+        /**
+         * Finds the fewest pushes that get a block from the goal room's entrance onto a goal,
+         * with the robot starting behind it and only the cells of the room to use
+         *@param goal the goal's cell
+         *@param blocked the cells holding blocks already
+         *@param cells (out) the cell the block is pushed from, per push
+         *@param directions (out) the direction it's pushed, per push
+         *@param walk (out) the steps the robot walks between the pushes
+         *@return false if the block can't get there
+         */
+        bool findPackingPath(int goal, std::vector<char>& blocked, std::vector<int>* cells, std::vector<int>* directions, int* walk);
+
+        /**
+         * Returns whether or not the robot can get from a cell in the goal room back to its entrance
+         *@param index the robot's cell
+         *@param blocked the cells holding blocks
+         *@return true if it can get out
          */
-        int best(std::map<int, int>& openset);
+        bool canLeaveRoom(int index, std::vector<char>& blocked);
 
         /**
-         * Evaluates (calculates h) how good this state is
-         * heuristic = manhatten distance
-         *@param index the location of the robot
-         *@param bx destination x
-         *@param by destination y
+         * Generates the next zobrist hash (splitmix64)
+         *@param seed (in/out) the generator state
+         *@return a random 64 bit value
          */
-        int evaluate(int index, int bx, int by);
+        uint64_t nextHash(uint64_t& seed);
 
         int width; /**< width of the level */
         int height; /**< height of the level */
         std::string walls; /**< the walls */
+        std::vector<uint64_t> blockHashes; /**< zobrist hash for a block on each cell */
+        std::vector<uint64_t> robotHashes; /**< zobrist hash for the robot region on each cell */
+        std::vector<int> goalAt; /**< which goal is on each cell, -1 for none */
+        std::vector<char> dead; /**< 1 for cells a block can't get to a goal from */
+        std::vector<char> tunnels; /**< 4 flags per cell in direction order, 1 if a block pushed that way goes on */
+        std::vector<char> room; /**< 1 for the cells of the goal room */
+        int entrance; /**< the cell blocks get into the goal room from, -1 if there's no goal room */
+        int entry; /**< the direction a block is pushed from the entrance into the room */
+        std::vector<int> packing; /**< the goal cells in the order they're filled */
+        std::vector<std::vector<int> > packingCells; /**< the cells a block is pushed from to fill each goal */
+        std::vector<std::vector<int> > packingDirections; /**< the directions it's pushed to fill each goal */
+        std::vector<int> packingWalks; /**< the steps walked between those pushes, per goal */
+        std::vector<int> neighbours; /**< 4 neighbours per cell in direction order, -1 for walls and the edge */
+        std::vector<int> floorIndex; /**< the dense number of each cell, -1 for walls */
+        int floorCount; /**< how many cells aren't walls */
+        bool reversed; /**< whether or not blocks are pulled instead of pushed */
+        std::vector<unsigned short> pushDistances; /**< the pushes from each floor cell (rows) to each goal (columns) */
+        Workspace workspace; /**< scratch grids for building states */
+        Corral corral; /**< finds PI-corrals while building states */
+        DeadlockPatterns patterns; /**< deadlocked neighbourhoods, kept between runs */
+        Matching matching; /**< matches blocks to goals for the heuristic */
 
         Robot* robot; /**< there is exactly 1 robot in a level */
         std::vector<Goal *> goals; /**< there can be many goals */
         std::vector<Block *> blocks; /**< there can be many blocks */
 
-        State* start; /**< the initial state */
+        std::vector<int> robotCells; /**< the cells the robot reached, in the order the last walk search found them */
+        std::vector<char> robotMoves; /**< the direction the robot walked into each cell, for pushBlock */
+        int costModel; /**< what a solution's cost counts */
+        std::vector<int> walks; /**< the steps to each cell from the robot's cell in the last state getWalk searched */
+        uint64_t walkBlocks; /**< the block hash of that state */
+        int walkStart; /**< the robot's cell in that state, -1 if none was searched */
 
         // diagnostic
         int states; /**< how many robot states are considered */
@@ -0,0 +1,76 @@
+#ifndef MATCHING_H
+#define MATCHING_H
+
+#include <vector>
+
+class Level;
+
+/**
+ * Min cost perfect matching of blocks to goals (Hungarian method), over push distances
+ * Each goal needs its own block, so this is a much tighter lower bound than the nearest
+ * block per goal, and when no matching exists at all the blocks can never all be placed
+ */
+class Matching
+{
+    public:
+        /**
+         * Inits an empty matcher
+         */
+        Matching();
+
+        /**
+         * Returns the fewest pushes needed to put a different block on every goal
+         *@param level the level, with its push distances
+         *@param blocks the cells holding blocks
+         *@param count how many blocks there are
+         *@param assignment (out) the column each block is matched to, goals first then dummy goals
+         *@return the cost of the best matching, -1 if the goals can't all be covered
+         */
+        int solve(Level& level, unsigned short* blocks, unsigned int count, unsigned short* assignment);
+
+        /**
+         * Fixes up the best matching after one block moved, instead of solving it again
+         * Dropping the moved block leaves the rest optimal, so the cheapest alternating path from
+         * the moved block back to its old column gives the new best matching.
+         * Taking a column from a row makes a negative edge, and states don't keep the duals that would
+         * make them non-negative for Dijkstra, so the path is found by FIFO label correcting (Bellman-Ford-Moore).
+         * A pass over the queued rows is O(n^2) for n rows and a row can be queued n times, O(n^3) at worst
+         * like solving again, but in practice a row is rarely queued twice, so it stays close to O(n^2)
+         *@param level the level, with its push distances
+         *@param blocks the cells holding blocks, with the moved one on its new cell
+         *@param count how many blocks there are
+         *@param assignment (in/out) the best matching before the move, fixed up for after it
+         *@param row which block moved
+         *@param cost the cost of the matching before the move, without the moved block's part
+         *@return the cost of the best matching, -1 if the goals can't all be covered
+         */
+        int repair(Level& level, unsigned short* blocks, unsigned int count, unsigned short* assignment, unsigned int row, int cost);
+
+        /**
+         * Returns what matching a block to a goal costs
+         *@param level the level, with its push distances
+         *@param index the block's cell
+         *@param column the goal, or a dummy goal past the real ones
+         *@return the pushes, or a cost bigger than any real matching if the block can't get there
+         */
+        int getCost(Level& level, int index, int column);
+
+    private:
+        std::vector<int> costs; /**< size x size cost matrix, blocks are rows and goals columns */
+        std::vector<int> rowPotential; /**< the dual variable of each row, 1 based */
+        std::vector<int> columnPotential; /**< the dual variable of each column, 1 based */
+        std::vector<int> columnRow; /**< the row matched to each column, 0 for none, 1 based */
+        std::vector<int> way; /**< the column before each column on the augmenting path */
+        std::vector<int> slack; /**< the smallest reduced cost into each column so far */
+        std::vector<char> used; /**< whether or not each column is in the alternating tree */
+
+        // repair
+        std::vector<int> rowOf; /**< the row holding each column */
+        std::vector<int> distance; /**< the cheapest path found to each row */
+        std::vector<int> viaRow; /**< the row that takes a row's column on the path to it */
+        std::vector<int> viaColumn; /**< that column */
+        std::vector<int> queue; /**< rows waiting to be relaxed */
+        std::vector<char> queued; /**< whether or not each row is in the queue */
+};
+
+#endif // MATCHING_H
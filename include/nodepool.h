@@ -0,0 +1,54 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <vector>
+
+/**
+ * Slab allocator for the fixed size nodes of one search
+ * Nodes are carved out of big slabs, released nodes are reused, and the whole search is freed at once
+ */
+class NodePool
+{
+    public:
+        /**
+         * Inits an empty pool
+         *@param _size how many bytes each node takes
+         */
+        NodePool(unsigned int _size);
+
+        /**
+         * Frees every slab
+         */
+        ~NodePool();
+
+        /**
+         * Returns memory for one node
+         *@return the node's memory
+         */
+        void* allocate();
+
+        /**
+         * Gives a node back so its memory can be handed out again
+         *@param node the node to release
+         */
+        void release(void* node);
+
+        /**
+         * Frees every node in the pool at once
+         */
+        void reset();
+
+        /**
+         * Returns how many bytes each node takes
+         *@return size
+         */
+        unsigned int getSize();
+
+    private:
+        unsigned int size; /**< bytes per node, a multiple of the pointer size */
+        std::vector<char *> slabs; /**< the slabs nodes are carved from */
+        unsigned int used; /**< how many nodes of the last slab are handed out */
+        void* released; /**< singly linked list of released nodes */
+};
+
+#endif // NODEPOOL_H
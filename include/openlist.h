@@ -0,0 +1,94 @@
+#ifndef OPENLIST_H
+#define OPENLIST_H
+
+#include <vector>
+
+class State;
+
+/**
+ * Binary min-heap of states ordered by f, ties broken by the lower h
+ * Every state remembers its slot in the heap so it can be updated in place
+ */
+class OpenList
+{
+    public:
+        /**
+         * Inits an empty open list
+         */
+        OpenList();
+
+        /**
+         * Returns whether or not the open list is empty
+         *@return true if there is nothing left to expand
+         */
+        bool empty();
+
+        /**
+         * Returns how many states are waiting to be expanded
+         *@return the heap size
+         */
+        unsigned int size();
+
+        /**
+         * Adds a state to the open list
+         *@param state the state to add
+         */
+        void push(State* state);
+
+        /**
+         * Returns the best state without removing it
+         *@return the state with the lowest f
+         */
+        State* top();
+
+        /**
+         * Removes and returns the best state
+         *@return the state with the lowest f
+         */
+        State* pop();
+
+        /**
+         * Swaps a state in the open list for a cheaper copy of itself
+         * The replacement takes over the old state's slot, the old state leaves the list
+         *@param old the state currently in the open list
+         *@param replacement the same state reached with a lower g
+         */
+        void replace(State* old, State* replacement);
+
+        /**
+         * Empties the open list without freeing the states
+         */
+        void clear();
+
+    private:
+        /**
+         * Returns whether or not state a should be expanded before state b
+         *@param a the first state
+         *@param b the second state
+         *@return true if a is better than b
+         */
+        bool better(State* a, State* b);
+
+        /**
+         * Moves the state at the index towards the root until the heap is ordered
+         *@param index the heap slot to fix
+         */
+        void siftUp(unsigned int index);
+
+        /**
+         * Moves the state at the index towards the leaves until the heap is ordered
+         *@param index the heap slot to fix
+         */
+        void siftDown(unsigned int index);
+
+        /**
+         * Puts a state in a heap slot, updating its handle
+         *@param index the heap slot
+         *@param state the state to put there
+         */
+        void place(unsigned int index, State* state);
+
+        std::vector<State *> heap; /**< the heap itself */
+};
+
+#endif // OPENLIST_H
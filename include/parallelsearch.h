@@ -0,0 +1,138 @@
+#ifndef PARALLELSEARCH_H
+#define PARALLELSEARCH_H
+
+#include "level.h"
+#include "state.h"
+#include "openlist.h"
+#include "pushqueue.h"
+#include "transpositiontable.h"
+#include "nodepool.h"
+#include "inbox.h"
+#include <vector>
+#include <pthread.h>
+
+/**
+ * Hash distributed A* (HDA*) over several threads
+ * Every thread owns the states whose blocks hash to it, with its own open list, table and pool.
+ * Pushes are sent to the thread owning the child, which builds it and checks it for duplicates.
+ * Solutions only set an upper bound, the search goes on until no thread has anything cheaper
+ * left and no pushes are on their way, so the solution found is still optimal
+ */
+class ParallelSearch
+{
+    public:
+        /**
+         * Inits a search
+         *@param level the loaded level
+         *@param threads how many threads to search with
+         */
+        ParallelSearch(Level& level, int threads);
+
+        /**
+         * Frees every thread's states
+         */
+        ~ParallelSearch();
+
+        /**
+         * Searches until the cheapest solution is proven
+         *@return the goal state, NULL if the level has no solution. It lives as long as the search
+         */
+        State* solve();
+
+        /**
+         * Returns how many states were expanded, over all threads
+         *@return states
+         */
+        int getStates();
+
+    private:
+        /**
+         * Everything one thread searches with
+         */
+        struct Worker {
+            /**
+             * Inits a thread's search
+             *@param level the level to copy
+             *@param size bytes per state
+             */
+            Worker(Level& level, unsigned int size);
+
+            ParallelSearch* search; /**< the search this thread belongs to */
+            int id; /**< which thread this is */
+            Level level; /**< a copy of the level, so the scratch space isn't shared */
+            NodePool pool; /**< the states this thread built */
+            TranspositionTable nodes; /**< the states this thread owns */
+            OpenList openlist; /**< the states this thread still has to expand */
+            PushQueue pushes; /**< the pushes this thread still has to build */
+            Inbox inbox; /**< pushes other threads sent here */
+            std::vector<Inbox::Batch *> outgoing; /**< pushes waiting to be sent, per thread */
+            std::vector<PushQueue::Push> children; /**< scratch for the pushes of an expanded state */
+            int states; /**< how many states this thread expanded */
+            int steps; /**< steps since the outgoing pushes were last sent */
+            pthread_t thread; /**< the thread itself */
+        };
+
+        /**
+         * Thread entry point
+         *@param worker the thread's worker
+         *@return NULL
+         */
+        static void* start(void* worker);
+
+        /**
+         * Runs one thread's search until every thread is out of work
+         *@param worker the thread's worker
+         */
+        void run(Worker* worker);
+
+        /**
+         * Builds a push or expands a state, whichever is better, as long as it could beat the best solution
+         *@param worker the thread's worker
+         *@return false if the thread has nothing left worth doing
+         */
+        bool step(Worker* worker);
+
+        /**
+         * Moves pushes sent to a thread into its push queue
+         *@param worker the thread's worker
+         *@param active (in/out) whether or not the thread counts as active, it does again if anything came
+         */
+        void receive(Worker* worker, bool* active);
+
+        /**
+         * Queues a push for the thread owning its child
+         *@param worker the sending thread's worker
+         *@param owner the owning thread
+         *@param push the push
+         */
+        void send(Worker* worker, int owner, PushQueue::Push& push);
+
+        /**
+         * Sends every push the thread is holding on to
+         *@param worker the thread's worker
+         */
+        void flush(Worker* worker);
+
+        /**
+         * Keeps a solution if it's the cheapest one so far
+         *@param goal the goal state
+         */
+        void record(State* goal);
+
+        /**
+         * Returns the thread that owns states with these blocks
+         *@param blockHash the zobrist hash of the blocks
+         *@return the thread
+         */
+        int owner(uint64_t blockHash);
+
+        Level& level; /**< the level being solved */
+        std::vector<Worker *> workers; /**< one per thread */
+        int bestCost; /**< g of the cheapest solution so far, read and written atomically */
+        State* best; /**< the cheapest solution so far */
+        pthread_mutex_t bestLock; /**< guards best and bestCost together */
+        uint64_t pending; /**< threads that still have work (high half) and batches sent but not received yet (low half),
+                               one word so a single atomic load sees both at the same time */
+};
+
+#endif // PARALLELSEARCH_H
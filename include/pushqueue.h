@@ -0,0 +1,80 @@
+#ifndef PUSHQUEUE_H
+#define PUSHQUEUE_H
+
+#include <vector>
+
+class State;
+
+/**
+ * Binary min-heap of pushes that haven't been turned into states yet, ordered like the open list
+ * Expanding a state only queues its pushes with a lower bound on f, the child state is built
+ * once the push comes out, so children that never get that far are never built at all
+ */
+class PushQueue
+{
+    public:
+        /**
+         * A push waiting to be built into a state
+         */
+        struct Push {
+            State* parent; /**< the state the push is made from */
+            int f; /**< lower bound on the child's f */
+            int h; /**< lower bound on the child's h */
+            int cost; /**< what the push adds to the parent's g, worked out while the parent's walks are known */
+            unsigned short block; /**< which block of the parent (position in cells) is pushed */
+            unsigned char direction; /**< the direction it's pushed */
+        };
+
+        /**
+         * Inits an empty queue
+         */
+        PushQueue();
+
+        /**
+         * Returns whether or not the queue is empty
+         *@return true if there are no pushes waiting
+         */
+        bool empty();
+
+        /**
+         * Returns how many pushes are waiting
+         *@return the heap size
+         */
+        unsigned int size();
+
+        /**
+         * Adds a push to the queue
+         *@param push the push
+         */
+        void push(Push& push);
+
+        /**
+         * Returns the best push without removing it
+         *@return the push with the lowest f
+         */
+        Push& top();
+
+        /**
+         * Removes and returns the best push
+         *@return the push with the lowest f
+         */
+        Push pop();
+
+        /**
+         * Empties the queue
+         */
+        void clear();
+
+    private:
+        /**
+         * Returns whether or not push a should be built before push b
+         *@param a the first push
+         *@param b the second push
+         *@return true if a is better than b
+         */
+        bool better(Push& a, Push& b);
+
+        std::vector<Push> heap; /**< the heap itself */
+};
+
+#endif // PUSHQUEUE_H
@@ -0,0 +1,72 @@
+#ifndef RUNFILE_H
+#define RUNFILE_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+/**
+ * A sorted run of records in a file, for searches that don't fit in memory
+ * A record is a key followed by data of a fixed size. Keys are delta compressed against
+ * the one before them: a byte with how many leading bytes they repeat, then the rest of the key.
+ * A run is written once, front to back, and read back memory mapped
+ */
+class RunFile
+{
+    public:
+        /**
+         * Inits a run that isn't open yet
+         *@param keyBytes how big a key is
+         *@param dataBytes how much data follows each key
+         */
+        RunFile(unsigned int keyBytes, unsigned int dataBytes);
+
+        /**
+         * Closes the run if it's still open
+         */
+        ~RunFile();
+
+        /**
+         * Starts writing a new run, replacing the file if it's there
+         *@param path the file
+         *@return true on success
+         */
+        bool create(const std::string& path);
+
+        /**
+         * Writes the next record, records must come in key order
+         *@param record the key and its data
+         */
+        void append(unsigned char* record);
+
+        /**
+         * Opens a run to read its records back
+         *@param path the file
+         *@return true on success
+         */
+        bool open(const std::string& path);
+
+        /**
+         * Reads the next record
+         *@return the key and its data, valid until the next call. NULL after the last record
+         */
+        unsigned char* next();
+
+        /**
+         * Closes the run, flushing it if it was being written
+         *@return false if writing it failed
+         */
+        bool close();
+
+    private:
+        unsigned int keyBytes; /**< how big a key is */
+        unsigned int dataBytes; /**< how much data follows each key */
+        std::vector<unsigned char> last; /**< the record last written or read */
+        bool started; /**< whether or not last holds a record yet */
+        FILE* out; /**< the file being written, NULL if it isn't */
+        unsigned char* mapped; /**< the file being read, NULL if it isn't */
+        size_t length; /**< how big the mapped file is */
+        size_t position; /**< where the next record starts in it */
+};
+
+#endif // RUNFILE_H
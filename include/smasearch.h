@@ -0,0 +1,149 @@
+#ifndef SMASEARCH_H
+#define SMASEARCH_H
+
+#include "level.h"
+#include "state.h"
+#include "transpositiontable.h"
+#include "nodepool.h"
+#include <set>
+
+/**
+ * Simplified memory-bounded A* (SMA*), A* that never keeps more than a set number of states
+ * States form a tree through their parent pointers. When it's full the open leaf with the worst f
+ * is dropped, and its parent remembers which push made it, the f it had, and the smallest f of what
+ * it dropped. The parent goes back in the open list at that f, and when its turn comes again only the
+ * dropped pushes are built again, each starting at the f it had so what was learned below it isn't lost.
+ * Each state keeps this next to it in the pool, after its block cells. A state as deep as the limit
+ * that isn't the goal could never have a child kept, so it isn't kept either
+ */
+class SmaSearch
+{
+    public:
+        /**
+         * Inits a search
+         *@param level the loaded level
+         *@param limit how many states may be kept at once
+         */
+        SmaSearch(Level& level, unsigned int limit);
+
+        /**
+         * Searches until the cheapest solution is found, the level is proven to have none,
+         * or the path to the cheapest open state doesn't fit in the limit
+         *@return the goal state, NULL if there's no solution. It lives as long as the search
+         */
+        State* solve();
+
+        /**
+         * Returns whether or not the search gave up because the limit was too small
+         *@return true if a solution might still exist
+         */
+        bool isOutOfMemory();
+
+        /**
+         * Returns how many states were expanded, counting the ones built again
+         *@return states
+         */
+        int getStates();
+
+    private:
+        /**
+         * What a state needs for SMA*, kept after it in the pool
+         */
+        struct Memo {
+            int f; /**< the f it's queued with, backed up from dropped children */
+            int forgotten; /**< the smallest f of the dropped children, NO_F for none */
+            int children; /**< how many of its children are kept */
+            unsigned int depth; /**< how many pushes it is from the start */
+            bool expanded; /**< whether or not its pushes were built yet */
+            bool listed; /**< whether or not it's the copy of its position in the table */
+        };
+
+        /**
+         * An open list entry, best first
+         */
+        struct Open {
+            int f; /**< the state's queued f */
+            int g; /**< its cost so far, deeper goes first on equal f */
+            State* state; /**< the state */
+
+            /**
+             * Orders entries best first, the deepest first on equal f so it's the shallowest that's dropped
+             *@param other the other entry
+             *@return true if this one goes first
+             */
+            bool operator<(const Open& other) const;
+        };
+
+        /**
+         * Builds a state's pushes, or just the ones that were dropped
+         *@param state the state
+         *@param f the f it was queued with, a lower bound for every child
+         *@return false if a child couldn't be kept, nothing could be dropped to make room
+         */
+        bool expand(State* state, int f);
+
+        /**
+         * Keeps a child, unless it's a position already kept at no more cost
+         * At the limit, the worst open leaves are dropped first to make room for it
+         *@param parent the expanded state
+         *@param child the new child
+         *@param f the lower bound the parent was queued with
+         *@return false if nothing could be dropped, the child is freed
+         */
+        bool add(State* parent, State* child, int f);
+
+        /**
+         * Drops the open leaf with the worst f, backing it up into its parent
+         *@return false if there's nothing that can be dropped
+         */
+        bool evict();
+
+        /**
+         * Drops a leaf that has nothing left to search, and any parents that leaves with nothing
+         *@param state the leaf
+         */
+        void prune(State* state);
+
+        /**
+         * Queues a state, taking it out of the open list first if it's already there
+         *@param state the state
+         *@param f its new f
+         */
+        void queue(State* state, int f);
+
+        /**
+         * Frees a state that's been taken out of the tree
+         *@param state the state
+         */
+        void remove(State* state);
+
+        /**
+         * Returns a state's SMA* data
+         *@param state the state
+         *@return memo
+         */
+        Memo* memo(State* state);
+
+        /**
+         * Returns the pushes of a state that were dropped, one per direction for each block.
+         * 0 for kept or never built, otherwise 1 more than how far its f was raised above its own
+         *@param state the state
+         *@return 4 per block
+         */
+        int* forgotten(State* state);
+
+        Level& level; /**< the level being solved */
+        unsigned int offset; /**< where the memo starts after a state */
+        NodePool pool; /**< the states kept */
+        TranspositionTable nodes; /**< the states kept, open or not */
+        std::set<Open> open; /**< states with pushes to build, best first */
+        unsigned int limit; /**< how many states may be kept */
+        unsigned int kept; /**< how many states are kept */
+        State* root; /**< the start state, never dropped */
+        State* expanding; /**< the state whose children are being added, not dropped while they are */
+        bool outOfMemory; /**< whether or not the search gave up on the limit */
+        bool cut; /**< whether or not a state was left out for being too deep */
+        int states; /**< how many states were expanded */
+};
+
+#endif // SMASEARCH_H
@@ -3,8 +3,10 @@
 
 #include "level.h"
 #include "state.h"
-#include <map>
-#include <string>
+#include "openlist.h"
+#include "pushqueue.h"
+#include "transpositiontable.h"
+#include "nodepool.h"
 
 /**
  * Solves Sokoban problems
@@ -24,6 +26,74 @@ class SokoStar
          */
         bool load(char* file);
 
+        /**
+         * Loads a level from its map, without reading the pattern file
+         *@param map the level's map, one row per line
+         *@return true on success, false if there was a problem loading the level
+         */
+        bool parse(std::string& map);
+
+        /**
+         * Sets how many threads to search with
+         *@param _threads the thread count, 1 searches on this thread alone
+         */
+        void setThreads(int _threads);
+
+        /**
+         * Sets whether or not to print progress and keep the pattern file up to date
+         *@param _verbose false to solve quietly
+         */
+        void setVerbose(bool _verbose);
+
+        /**
+         * Sets whether or not to search from the goals as well as from the start
+         *@param _bidirectional true to search both ways, giving up on the cheapest solution
+         */
+        void setBidirectional(bool _bidirectional);
+
+        /**
+         * Sets how much memory IDA* may use for its transposition table, instead of searching with A*
+         *@param _megabytes the table size, 0 searches with A*
+         */
+        void setIdaMemory(int _megabytes);
+
+        /**
+         * Sets how many states SMA* may keep, instead of searching with A*
+         *@param _states the limit, 0 searches with A*
+         */
+        void setSmaLimit(int _states);
+
+        /**
+         * Sets a directory to keep the search in files, instead of searching with A* in memory
+         *@param _directory the directory, empty searches with A*
+         */
+        void setExternalDirectory(std::string& _directory);
+
+        /**
+         * Sets a budget to search with ARA*, taking the best solution found within it
+         *@param _msec how long it may search, 0 for no limit
+         *@param _states how many states it may expand, 0 for no limit. Both 0 searches with A*
+         */
+        void setAnytime(int _msec, int _states);
+
+        /**
+         * Sets whether or not to fill a goal room in a fixed order, pushing each block from its entrance straight to its goal
+         *@param _goalMacros true to pack the goal room, giving up on the cheapest solution
+         */
+        void setGoalMacros(bool _goalMacros);
+
+        /**
+         * Sets what the cheapest solution is cheapest in
+         *@param _costModel COST_SWITCHES, COST_PUSHES, COST_PUSHES_MOVES or COST_MOVES_PUSHES
+         */
+        void setCostModel(int _costModel);
+
+        /**
+         * Sets a file to load deadlock patterns from, and to save the ones learned to
+         *@param _patternFile the file, empty to neither load nor save patterns
+         */
+        void setPatternFile(std::string& _patternFile);
+
         /**
          * Solves the problem
          */
@@ -34,13 +104,53 @@ class SokoStar
          */
         void printSolution();
 
+        /**
+         * Returns whether or not the last solve found a solution
+         *@return solved
+         */
+        bool isSolved();
+
+        /**
+         * Returns whether or not the last solve stopped at its ARA* budget, before proving it had the cheapest solution
+         *@return true if it ran out of time or states
+         */
+        bool isOutOfBudget();
+
+        /**
+         * Returns how many pushes the solution takes
+         *@return the pushes
+         */
+        int getPushCount();
+
+        /**
+         * Returns how many robot steps the solution takes, pushes included
+         *@return the moves
+         */
+        int getMoveCount();
+
+        /**
+         * Returns how many block states the last solve expanded
+         *@return states
+         */
+        int getStates();
+
+        /**
+         * Returns how long the last solve took
+         *@return msec
+         */
+        float getMsec();
+
+        /**
+         * Returns the deadlock patterns the level is searched with
+         *@return patterns
+         */
+        DeadlockPatterns& getPatterns();
+
     private:
         /**
-         * Grabs the best guess from the openset
-         *@param openset the open set
-         *@return the bets guess of where to go next
+         * Runs A* on this thread, building the path if a solution is found
          */
-        State* best(std::map<std::string, State *>& openset);
+        void search();
 
         /**
          * Builds the path from the end state to the start state
@@ -48,6 +158,13 @@ class SokoStar
          */
         void buildPath(State* node);
 
+        /**
+         * Builds the path through the state where the forward and backward searches met
+         *@param forward the forward state, the pushes up to it come first
+         *@param backward the backward state, the pushes undoing its pulls come after
+         */
+        void buildPath(State* forward, State* backward);
+
         /**
          * Translates the direction constant to a string
          *@param direction the direction to translate
@@ -56,6 +173,19 @@ class SokoStar
         const char* asDirection(int direction);
 
         Level level; /**< the sokoban level to solve */
+        int threads; /**< how many threads to search with */
+        bool verbose; /**< whether or not to print progress */
+        bool bidirectional; /**< whether or not to search from the goals too */
+        int idaMemory; /**< megabytes of transposition table for IDA*, 0 for A* */
+        int smaLimit; /**< how many states SMA* may keep, 0 for A* */
+        std::string externalDirectory; /**< where the external search keeps its files, empty for A* */
+        int anytimeMsec; /**< how long ARA* may search, 0 for no limit */
+        int anytimeStates; /**< how many states ARA* may expand, 0 for no limit */
+        bool goalMacros; /**< whether or not to pack the goal room in a fixed order */
+        int costModel; /**< what a solution's cost counts */
+        std::string patternFile; /**< where deadlock patterns are kept between runs, empty for nowhere */
+        bool solved; /**< whether or not the last solve found a solution */
+        bool outOfBudget; /**< whether or not the last solve ran out of its ARA* budget */
 
         std::vector<int> rBlocksPushed; /**< the blocks we push (in reverse) */
         std::vector<int> rPushDirection; /**< the direction we push the blocks (in reverse) */
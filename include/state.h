@@ -1,42 +1,171 @@
 #ifndef STATE_H
 #define STATE_H
 
-#include <string>
 #include <vector>
-#include <map>
-#include "block.h"
-#include "goal.h"
+#include <stdint.h>
+#include "pushqueue.h"
 
 class Level;
+class NodePool;
+class Workspace;
 
 /**
  * A state that the game board can be in
+ * States live in a NodePool, the block cells, their matched goals and their pushes
+ * are stored inline right after the state.
+ * Backward states are built on a reversed level and pull blocks instead of pushing them
  */
 class State
 {
     public:
         /**
-         * Inits a new state from the level
+         * Builds the starting state of a level
+         *@param pool the pool to put the state in
+         *@param level the level
+         *@return the new state
          */
-        State(Level& level);
+        static State* create(NodePool& pool, Level& level);
 
         /**
-         * Frees any memory used by the state
+         * Builds a state with the robot and blocks somewhere else than at the start
+         *@param pool the pool to put the state in
+         *@param level the level
+         *@param blocks the cells holding blocks
+         *@param robot the robot's cell
+         *@return the new state
          */
-        ~State();
+        static State* create(NodePool& pool, Level& level, std::vector<int>& blocks, int robot);
 
         /**
-         * Returns the representation of this state
-         *@return value
+         * Builds a state a backward search starts from, its children are pulls
+         *@param pool the pool to put the state in
+         *@param level the reversed level
+         *@param blocks the cells holding blocks
+         *@param robot the robot's cell
+         *@return the new state
          */
-        std::string get();
+        static State* createBackward(NodePool& pool, Level& level, std::vector<int>& blocks, int robot);
+
+        /**
+         * Builds a state that was written out to disk, carrying on from where its path left it
+         *@param pool the pool to put the state in
+         *@param level the level
+         *@param blocks the cells holding blocks
+         *@param robot the robot's cell
+         *@param _g the cost it was reached with
+         *@param _moved the cell of the block pushed last, -1 for the start state
+         *@return the new state, without a parent
+         */
+        static State* create(NodePool& pool, Level& level, std::vector<int>& blocks, int robot, int _g, int _moved);
+
+        /**
+         * Builds the state a queued push, or pull for a backward parent, leads to
+         *@param pool the pool to put the state in
+         *@param level the level, reversed for a backward parent
+         *@param parent the state the push is made from
+         *@param block which block of the parent (position in cells) is pushed
+         *@param direction the direction it moves
+         *@param cost what the push adds to the parent's g, from getPushCost
+         *@return the new state, with h at DEAD_END if it's deadlocked
+         */
+        static State* create(NodePool& pool, Level& level, State* parent, unsigned int block, int direction, int cost);
+
+        /**
+         * Returns how many bytes a state takes, including the inline block cells
+         *@param blocks how many blocks there are
+         *@return the node size for the pool
+         */
+        static unsigned int getSize(unsigned int blocks);
+
+        /**
+         * Returns the zobrist hash of this state
+         *@return hash
+         */
+        uint64_t getHash();
+
+        /**
+         * Returns whether or not two states have the same blocks and robot region
+         *@param other the state to compare against
+         *@return true if they are the same position
+         */
+        bool sameAs(State* other);
+
+        /**
+         * Returns whether or not this state is waiting in the open list
+         *@return true if the state has an open list slot
+         */
+        bool isOpen();
+
+        /**
+         * Returns whether or not this state belongs to a backward search
+         *@return backward
+         */
+        bool isBackward();
 
         /**
          * Returns the states this state can change into
          *@param children (out) the child states
          *@param level the level these states are in
+         *@param pool the pool to put the children in
          */
-        void getChildren(std::vector<State *>* children, Level& level);
+        void getChildren(std::vector<State *>* children, Level& level, NodePool& pool);
+
+        /**
+         * Returns the pushes this state can make without building the children
+         * Each push gets a lower bound on its child's f: one push changes the matching by at most one,
+         * and its cost, so the robot's walks are only searched once for all of them
+         *@param pushes (out) the pushes
+         *@param level the level this state is in
+         */
+        void getPushes(std::vector<PushQueue::Push>* pushes, Level& level);
+
+        /**
+         * Returns what pushing a block once costs from this state, in the level's cost model
+         * Pushing a different block than the last one also pays for the robot walking over to it,
+         * as a block count, or as the exact walk when moves are counted
+         *@param level the level this state is in
+         *@param block which block (position in cells) is pushed
+         *@param direction the direction it's pushed, or pulled for a backward state
+         *@return the cost added to g
+         */
+        int getPushCost(Level& level, unsigned int block, int direction);
+
+        /**
+         * Returns the cell a push takes a block to, on through a tunnel in one go,
+         * or from the goal room's entrance to the next goal of the packing order
+         *@param level the level this state is in
+         *@param block which block (position in cells) is pushed
+         *@param direction the direction it's pushed, or pulled for a backward state
+         *@param steps (out) how many cells it moves up to the goal room, NULL if not needed
+         *@param step (out) the packing step it fills, -1 if it stays short of the goal room, NULL if not needed
+         *@return the cell the child has the block on
+         */
+        int getDestination(Level& level, unsigned int block, int direction, int* steps, int* step);
+
+        /**
+         * Returns how many blocks there are
+         *@return count
+         */
+        int getBlockCount();
+
+        /**
+         * Returns the cell a block is on
+         *@param block which block, in cell order
+         *@return the cell
+         */
+        int getBlock(int block);
+
+        /**
+         * Returns the lowest cell the robot can reach, which identifies where it is
+         *@return region
+         */
+        int getRegion();
+
+        /**
+         * Returns the zobrist hash of the block positions alone
+         *@return blockHash
+         */
+        uint64_t getBlockHash();
 
         /**
          * Returns the heuristic cost
@@ -62,10 +191,12 @@ class State
         State* getParent();
 
         /**
-         * Returns the block that was pushed to get this state
-         *@return blockPushed
+         * Returns the cell the pushed block was on before the push, before the first one through a tunnel
+         * For a backward state it's the push undoing the pull, from this state to its parent
+         *@param level the level this state is in
+         *@return the cell the block is pushed from, -1 for the start state
          */
-        int getBlockPushedIndex();
+        int getPushedCell(Level& level);
 
         /**
          * Returns the path to reach the side of the block to push it
@@ -75,62 +206,165 @@ class State
 
         /**
          * Returns the direction that block was pushed
-         *@return pushDirection
+         * For a backward state it's the push undoing the pull, from this state to its parent
+         *@return the push direction
          */
         int getPushDirection();
 
+        /**
+         * Returns how many cells the block moved to reach this state, it's pushed through tunnels at once
+         *@return the pushes, 0 for the start state
+         */
+        int getSteps();
+
+        /**
+         * Returns the cell the block that moved last ended up on
+         *@return the cell, -1 for the start state
+         */
+        int getMoved();
+
+        /**
+         * Returns whether or not the push into the goal room went on to the next goal in the packing order
+         *@return true if the block was packed
+         */
+        bool isPacked();
+
         /**
          * Prints this state
+         *@param level the level this state is in
          */
-        void print();
+        void print(Level& level);
 
     private:
+        friend class OpenList;
+
+        /**
+         * Inits a new state with no parent
+         *@param level the level
+         *@param blocks the cells holding blocks
+         *@param robot the robot's cell
+         *@param _backward whether or not the state pulls blocks
+         */
+        State(Level& level, std::vector<int>& blocks, int robot, bool _backward);
+
         /**
          * Builds a child state from the parent
          *@param parent the parent state
          *@param level the level that this state is in
-         *@param block which block was pushed to reach this state
-         *@param direction the direction it was pushed
+         *@param block which block (position in cells) was pushed to reach this state
+         *@param direction the direction it was pushed, or pulled for a backward parent
+         *@param cost what the push adds to the parent's g, from getPushCost
          */
-        State(State* _parent, Level& level, unsigned int block, int direction);
+        State(State* _parent, Level& level, unsigned int block, int direction, int cost);
 
         /**
          * Evaluates (calculates h) how good this state is
-         * heuristic = manhatten distance
-         *@param goals the goals we want to cover
+         * heuristic = pushes of the cheapest matching of blocks to goals, DEAD_END if there is none
+         *@param level the level with the goals we want to cover
+         */
+        void evaluate(Level& level);
+
+        /**
+         * Evaluates (calculates h) a child from its parent's matching, only one block moved
+         *@param level the level with the goals we want to cover
+         *@param block which block (position in cells) was pushed
+         *@param cost the pushes of the parent's matching without the pushed block's part
+         */
+        void evaluate(Level& level, unsigned int block, int cost);
+
+        /**
+         * Floodfills the robot's location, finding the region and the pushable blocks,
+         * or pullable ones for a backward state
+         * The blocks must already be placed in the workspace
+         *@param level the level this state is in
+         *@param robot the robot's cell
          */
-        void evaluate(std::vector<Goal *>& goals);
+        void floodFill(Level& level, int robot);
 
         /**
-         * Floodfills the robot's location
-         *@param x robot's x coordinate
-         *@param y robot's y coordinate
+         * Returns whether or not a block is stuck for good, along with every block holding it in place
+         * Blocks still being checked further up count as walls, so blocks locking each other are frozen
+         *@param level the level this state is in
+         *@param index the cell of the block
+         *@param offGoal (out) set if a frozen block is not on a goal
+         *@return true if the block can never be pushed again
          */
-        void floodFill(int x, int y);
+        bool isFrozen(Level& level, int index, bool* offGoal);
 
         /**
-         * Floodfills from a direction
-         *@param x robot's x coordinate
-         *@param y robot's y coordinate
-         *@param dir the direction
+         * Returns whether or not a block can't move along an axis
+         *@param level the level this state is in
+         *@param index the cell of the block
+         *@param direction one side of the axis, the other side is direction^1
+         *@param offGoal (out) set if a block this one leans on is frozen off a goal
+         *@return true if the block can't be pushed either way along the axis
          */
-        void floodFill(int x, int y, int dir);
+        bool isBlockedOnAxis(Level& level, int index, int direction, bool* offGoal);
 
-        std::vector<Block *> blocks; /**< the blocks in the stage */
-        std::map<int, Block *> blocksPos; /**< reference the blocks by position */
-        //std::vector<Goal *>& goals; /**< the goals to put the blocks on */
-        //std::string* wall_map; /**< the walls in the stage */
+        /**
+         * Returns whether or not pushing a block to its cell froze blocks off goals
+         * Known deadlock patterns are looked up first, they're learned from deadlocked corrals
+         *@param level the level this state is in
+         *@return true if the state can never be solved
+         */
+        bool isDeadlocked(Level& level);
+
+        /**
+         * Looks for a PI-corral, cutting the pushes down to it and checking it isn't deadlocked
+         * Must be called right after the flood fill, it takes the blocks back out of the workspace
+         * and leaves h at DEAD_END if the corral can't be solved
+         *@param level the level this state is in
+         */
+        void findCorral(Level& level);
+
+        /**
+         * Puts this state's blocks in the workspace
+         *@param workspace the workspace
+         */
+        void placeBlocks(Workspace& workspace);
+
+        /**
+         * Takes this state's blocks back out of the workspace
+         *@param workspace the workspace
+         */
+        void removeBlocks(Workspace& workspace);
+
+        /**
+         * Returns the cells holding blocks, sorted, stored right after the state
+         *@return count cells
+         */
+        unsigned short* cells();
+
+        /**
+         * Returns the goal each block in cells is matched to by the heuristic, stored after the cells
+         *@return count columns of the matching
+         */
+        unsigned short* assignment();
+
+        /**
+         * Returns the directions each block in cells can be pushed, a bit per direction,
+         * or pulled for a backward state
+         *@return count bitmasks
+         */
+        unsigned char* pushable();
 
-        int width; /**< width of the map */
+        // the canonical key is cells() together with region
+        unsigned short count; /**< how many blocks there are */
+        bool backward; /**< whether or not this state pulls blocks, searching back from the goals */
+        unsigned char steps; /**< how many cells the block moved, more than 1 through a tunnel */
+        int region; /**< the lowest cell the robot can reach */
+        uint64_t blockHash; /**< zobrist hash of the block positions */
+        uint64_t hash; /**< zobrist hash of the blocks and the robot region */
 
         // A* stuff
-        std::string value; /**< the value of the state */
         int g; /**< the cost to reach this state */
         int h; /**< the heuristic estimate of this state */
 
         State* parent; /**< the state before this one */
-        int blockPushed; /**< which block must be pushed to get this state */
+        int moved; /**< the cell the pushed block ended up on, -1 for the start state */
         int pushDirection; /**< which direction that block was pushed */
+        int openIndex; /**< slot in the open list heap, -1 if not in it */
+        bool packed; /**< whether or not the block went on from the goal room's entrance to its goal */
 };
 
 #endif // STATE_H
@@ -0,0 +1,88 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include <vector>
+
+class State;
+
+/**
+ * Open addressing hash table of states keyed by their zobrist hash
+ * Holds every state the search has seen, open or closed
+ */
+class TranspositionTable
+{
+    public:
+        /**
+         * Inits an empty table
+         */
+        TranspositionTable();
+
+        /**
+         * Finds the stored copy of a state
+         *@param state the state to look for
+         *@return the stored state, NULL if it hasn't been seen
+         */
+        State* find(State* state);
+
+        /**
+         * Adds a state that isn't in the table yet
+         *@param state the state to add
+         */
+        void insert(State* state);
+
+        /**
+         * Swaps the stored copy of a state for another copy
+         *@param old the stored state
+         *@param replacement the state to store in its place
+         */
+        void replace(State* old, State* replacement);
+
+        /**
+         * Takes a stored state out of the table, without freeing it
+         *@param state the stored state
+         */
+        void remove(State* state);
+
+        /**
+         * Returns how many states are stored
+         *@return size
+         */
+        unsigned int size();
+
+        /**
+         * Returns how many slots the table has
+         *@return the slot count
+         */
+        unsigned int capacity();
+
+        /**
+         * Returns the state in a slot
+         *@param index the slot
+         *@return the state, NULL if the slot is empty
+         */
+        State* at(unsigned int index);
+
+        /**
+         * Empties the table without freeing the states
+         */
+        void clear();
+
+    private:
+        /**
+         * Returns the slot holding a state, or the empty slot it belongs in
+         *@param state the state to look for
+         *@return the slot index
+         */
+        unsigned int probe(State* state);
+
+        /**
+         * Doubles the slot count and reinserts every state
+         */
+        void grow();
+
+        std::vector<State *> slots; /**< the slots, NULL when empty */
+        unsigned int mask; /**< slot count-1, the slot count is a power of 2 */
+        unsigned int count; /**< how many states are stored */
+};
+
+#endif // TRANSPOSITIONTABLE_H
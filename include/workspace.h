@@ -0,0 +1,143 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+/**
+ * Scratch grids reused by every state built on a level
+ * States don't keep a board of their own, they paint their blocks here while they need one.
+ * Blocks are also kept as a bitboard, a row of 64 bit words per map row, so the robot's
+ * reach is worked out a whole word of cells at a time
+ */
+class Workspace
+{
+    public:
+        /**
+         * Inits an empty workspace
+         */
+        Workspace();
+
+        /**
+         * Sizes the grids for a level
+         *@param _width the map width
+         *@param height the map height
+         *@param walls the wall map
+         *@param dead 1 for cells a block must never be pushed onto
+         */
+        void resize(int _width, int height, std::string& walls, std::vector<char>& dead);
+
+        /**
+         * Marks a cell as holding a block
+         *@param index the cell
+         *@param block which block is there
+         */
+        void placeBlock(int index, int block);
+
+        /**
+         * Marks a cell as not holding a block
+         *@param index the cell
+         */
+        void removeBlock(int index);
+
+        /**
+         * Returns the block on a cell
+         *@param index the cell
+         *@return the block, -1 if there is none
+         */
+        int getBlock(int index);
+
+        /**
+         * Forgets every visited cell
+         */
+        void resetVisited();
+
+        /**
+         * Marks a cell as visited
+         *@param index the cell
+         */
+        void visit(int index);
+
+        /**
+         * Marks a cell as not visited
+         *@param index the cell
+         */
+        void unvisit(int index);
+
+        /**
+         * Returns whether or not a cell was visited since the last reset
+         *@param index the cell
+         *@return true if visited
+         */
+        bool isVisited(int index);
+
+        /**
+         * Finds every cell the robot can walk to around the placed blocks
+         *@param start the robot's cell
+         *@return the lowest cell it can reach
+         */
+        int reach(int start);
+
+        /**
+         * Returns whether or not the robot reached a cell in the last reach
+         *@param index the cell
+         *@return true if it can walk there
+         */
+        bool isReached(int index);
+
+        /**
+         * Finds the pushes the robot can make from the cells it reached,
+         * onto cells that are free and not dead
+         *@param pushable (out) a bit per direction for each block, indexed like the placed blocks
+         */
+        void findPushes(unsigned char* pushable);
+
+        /**
+         * Finds the pulls the robot can make from the cells it reached, each moving a block
+         * onto a cell that is not dead with the robot stepping back onto the free cell past it
+         *@param pullable (out) a bit per direction the block moves for each block, indexed like the placed blocks
+         */
+        void findPulls(unsigned char* pullable);
+
+    private:
+        /**
+         * Spreads the reached cells of a row along the free cells of the row
+         *@param row the first word of the row
+         */
+        void fillRow(int row);
+
+        /**
+         * Returns a word of a bitboard moved along its row, carrying across the words of the row
+         *@param bits the bitboard
+         *@param i the word
+         *@param w the word's place in its row
+         *@param by how many cells to the right to look, negative to look left, at most 63
+         *@return bit x is the cell by cells to the right of the word's cell x
+         */
+        uint64_t along(std::vector<uint64_t>& bits, int i, int w, int by);
+
+        /**
+         * Marks the blocks on the set bits of a word as pushable in a direction
+         *@param bits the word
+         *@param cell the cell of the word's first bit
+         *@param direction the push direction
+         *@param pushable (out) the pushes per block
+         */
+        void addPushes(uint64_t bits, int cell, int direction, unsigned char* pushable);
+
+        std::vector<int> blocks; /**< which block is on each cell, -1 for none */
+        std::vector<unsigned int> visited; /**< the stamp each cell was last visited with */
+        unsigned int stamp; /**< the current visit stamp, bumping it resets visited in O(1) */
+
+        // bitboards, bit x of word y*words+x/64 is the cell x+y*width
+        int width; /**< the map width */
+        int rows; /**< the map height */
+        int words; /**< words per row */
+        std::vector<uint64_t> floor; /**< cells that aren't walls */
+        std::vector<uint64_t> targets; /**< cells a block can be pushed onto, ignoring other blocks */
+        std::vector<uint64_t> blockBits; /**< cells holding a block */
+        std::vector<uint64_t> reached; /**< cells the robot reached in the last reach */
+};
+
+#endif // WORKSPACE_H
@@ -1,21 +1,134 @@
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include "sokostar.h"
+#include "batchsolver.h"
+#include "constants.h"
 
 /**
  * main entry point for SokoStar
  *@param argc number of args passed to program
- *@param argv passed args, should pass the filename for the sokoban map to load
+ *@param argv passed args, should pass the filename for the sokoban map to load,
+ * optionally after -t and the number of threads to search with, -d to search from the goals too,
+ * -i and the megabytes IDA* may use, -s and the states SMA* may keep,
+ * -e and a directory to keep the search in files, or -a and -n with the milliseconds
+ * and states ARA* may take to improve its solutions. -g fills a room holding the goals in a fixed order.
+ * -c picks what the solution is cheapest in: pushes, pushes-moves or moves-pushes,
+ * by default a push costs more when the robot switches to another block.
+ * -p and a file loads deadlock patterns from it and saves the ones learned back.
+ * With -b it's a collection file or a directory of levels, solved -t at a time,
+ * each with ARA* within the -a and -n budget if there is one
  *@return 0 on success
  */
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        printf("Error: format is\n\t%s SOKOBAN_PROBLEM\n", argv[0]);
+    int threads = 1;
+    bool batch = false;
+    bool bidirectional = false;
+    bool goalMacros = false;
+    int costModel = COST_SWITCHES;
+    int idaMemory = 0;
+    int smaLimit = 0;
+    std::string externalDirectory;
+    std::string patternFile;
+    int anytimeMsec = 0;
+    int anytimeStates = 0;
+    int arg = 1;
+    while (arg < argc-1) {
+        if (!strcmp(argv[arg], "-t")) {
+            threads = atoi(argv[arg+1]);
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-b")) {
+            batch = true;
+            arg++;
+        } else if (!strcmp(argv[arg], "-i")) {
+            idaMemory = atoi(argv[arg+1]);
+            if (idaMemory < 1) {
+                threads = 0; // shows the usage
+            }
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-s")) {
+            smaLimit = atoi(argv[arg+1]);
+            if (smaLimit < 1) {
+                threads = 0; // shows the usage
+            }
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-a") || !strcmp(argv[arg], "-n")) {
+            int budget = atoi(argv[arg+1]);
+            if (budget < 1) {
+                threads = 0; // shows the usage
+            } else if (argv[arg][1] == 'a') {
+                anytimeMsec = budget;
+            } else {
+                anytimeStates = budget;
+            }
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-e")) {
+            externalDirectory = argv[arg+1];
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-p")) {
+            patternFile = argv[arg+1];
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-d")) {
+            bidirectional = true;
+            arg++;
+        } else if (!strcmp(argv[arg], "-c")) {
+            if (!strcmp(argv[arg+1], "pushes")) {
+                costModel = COST_PUSHES;
+            } else if (!strcmp(argv[arg+1], "pushes-moves")) {
+                costModel = COST_PUSHES_MOVES;
+            } else if (!strcmp(argv[arg+1], "moves-pushes")) {
+                costModel = COST_MOVES_PUSHES;
+            } else {
+                threads = 0; // shows the usage
+            }
+            arg += 2;
+        } else if (!strcmp(argv[arg], "-g")) {
+            goalMacros = true;
+            arg++;
+        } else {
+            break;
+        }
+    }
+    // each of these picks a different search, and a batch solves every level the same way
+    int searches = bidirectional+(idaMemory > 0)+(smaLimit > 0)+!externalDirectory.empty()+(anytimeMsec > 0 || anytimeStates > 0);
+    bool conflicting;
+    if (batch) {
+        conflicting = searches > (anytimeMsec > 0 || anytimeStates > 0) || goalMacros || costModel != COST_SWITCHES;
+    } else {
+        conflicting = searches+(threads > 1) > 1;
+    }
+    if (conflicting) {
+        printf("Error: only one of -t, -d, -i, -s, -e and -a/-n can be used, and -b only takes -p, -t, -a and -n\n");
+    }
+    if (arg != argc-1 || threads < 1 || conflicting) {
+        printf("Error: format is\n\t%s [-g] [-p PATTERN_FILE] [-c pushes | pushes-moves | moves-pushes] [-t THREADS | -d | -i MEGABYTES | -s STATES | -e DIRECTORY | -a MSEC [-n STATES] | -n STATES] SOKOBAN_PROBLEM\n", argv[0]);
+        printf("\t%s -b [-p PATTERN_FILE] [-t THREADS] [-a MSEC] [-n STATES] COLLECTION_OR_DIRECTORY\n", argv[0]);
         printf("Level file format is the most common representation, described at\nhttp://www.sokoban-online.de/help/sokoban/level-format.html");
         return -1;
     }
 
+    if (batch) {
+        BatchSolver solver(threads);
+        solver.setPatternFile(patternFile);
+        solver.setBudget(anytimeMsec, anytimeStates);
+        if (!solver.load(argv[arg])) {
+            return -2;
+        }
+        solver.solve();
+        return 0;
+    }
+
     SokoStar solver;
-    if (solver.load(argv[1])) {
+    solver.setThreads(threads);
+    solver.setBidirectional(bidirectional);
+    solver.setIdaMemory(idaMemory);
+    solver.setSmaLimit(smaLimit);
+    solver.setExternalDirectory(externalDirectory);
+    solver.setAnytime(anytimeMsec, anytimeStates);
+    solver.setGoalMacros(goalMacros);
+    solver.setCostModel(costModel);
+    solver.setPatternFile(patternFile);
+    if (solver.load(argv[arg])) {
         solver.solve();
         solver.printSolution();
     } else {
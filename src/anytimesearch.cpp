@@ -0,0 +1,258 @@
+#include "anytimesearch.h"
+#include "constants.h"
+#include <climits>
+#include <cstddef>
+
+#define START_WEIGHT 5.0 /**< w of the first round */
+#define LAST_WEIGHT 1.1 /**< below this w drops straight to 1 */
+
+/**
+ * Inits a search
+ *@param _level the loaded level
+ *@param _msec how long it may search, 0 for no limit
+ *@param _limit how many states it may expand, 0 for no limit
+ */
+AnytimeSearch::AnytimeSearch(Level& _level, int _msec, int _limit):
+        level(_level),
+        offset((State::getSize(_level.getBlocks().size())+sizeof(int)-1)/sizeof(int)*sizeof(int)),
+        pool(offset+sizeof(Memo)) {
+    weight = START_WEIGHT;
+    round = 0;
+    best = NULL;
+    bound = 0;
+    done = false;
+    outOfBudget = false;
+    msec = _msec > 0 ? _msec : 0;
+    limit = _limit > 0 ? _limit : 0;
+    states = 0;
+    gettimeofday(&start, NULL);
+}
+
+/**
+ * Searches until a cheaper solution is found, or the one found last is proven closer to the cheapest
+ *@return the best goal state so far, NULL once there's nothing better to find or the budget ran out.
+ * It lives as long as the search
+ */
+State* AnytimeSearch::improve() {
+    State* last = best;
+    double lastBound = bound;
+    while (!done) {
+        if (round == 0) {
+            State* root = level.getStart(pool);
+            if (root->getH() == DEAD_END) {
+                done = true;
+                break;
+            }
+            Memo* m = memo(root);
+            m->round = 0;
+            m->waiting = false;
+            nodes.insert(root);
+            queue(root);
+            if (root->getH() == 0) {
+                best = root;
+            }
+        } else {
+            // lower w, the waiting states join the open ones and everything is ordered by it
+            weight = 1+(weight-1)/2;
+            if (weight < LAST_WEIGHT) {
+                weight = 1;
+            }
+            for (unsigned int i = 0; i < waiting.size(); i++) {
+                if (memo(waiting[i])->waiting) { // not made any cheaper since
+                    memo(waiting[i])->waiting = false;
+                    queue(waiting[i]);
+                }
+            }
+            waiting.clear();
+            std::set<Open> old;
+            old.swap(open);
+            for (std::set<Open>::iterator i = old.begin(); i != old.end(); i++) {
+                queue(i->state);
+            }
+        }
+        round++;
+
+        bool finished = search();
+        findBound(finished);
+        if (!finished || weight == 1 || (open.empty() && waiting.empty())) {
+            done = true;
+        }
+        if (best != last || (best != NULL && (lastBound == 0 || bound < lastBound))) {
+            return best;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Returns how far the best solution can be from the cheapest one
+ *@return at most how many times the cheapest solution's cost it takes, 0 if it isn't known yet
+ */
+double AnytimeSearch::getBound() {
+    return bound;
+}
+
+/**
+ * Returns whether or not the search stopped because the budget ran out
+ *@return true if there might be something better left to find
+ */
+bool AnytimeSearch::isOutOfBudget() {
+    return outOfBudget;
+}
+
+/**
+ * Returns how many states were expanded, over all rounds
+ *@return states
+ */
+int AnytimeSearch::getStates() {
+    return states;
+}
+
+/**
+ * Returns how long the search has been going
+ *@return milliseconds
+ */
+float AnytimeSearch::getMsec() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return (now.tv_sec-start.tv_sec)*1000.f+(now.tv_usec-start.tv_usec)/1000.f;
+}
+
+/**
+ * Orders entries best first
+ *@param other the other entry
+ *@return true if this one goes first
+ */
+bool AnytimeSearch::Open::operator<(const Open& other) const {
+    if (f != other.f) {
+        return f < other.f;
+    }
+    if (h != other.h) {
+        return h < other.h;
+    }
+    return state < other.state;
+}
+
+/**
+ * Expands states until nothing open is cheaper than the best solution, or the budget runs out
+ *@return true if the round was finished
+ */
+bool AnytimeSearch::search() {
+    std::vector<State *> children;
+    while (!open.empty() && (best == NULL || open.begin()->f < best->getG())) {
+        if (isOverBudget()) {
+            outOfBudget = true;
+            return false;
+        }
+        State* state = open.begin()->state;
+        open.erase(open.begin());
+        memo(state)->open = false;
+        memo(state)->round = round;
+        states++;
+        if (state->getH() == 0) { // a goal, it was taken when it was added
+            continue;
+        }
+        children.clear();
+        state->getChildren(&children, level, pool);
+        for (unsigned int i = 0; i < children.size(); i++) {
+            add(children[i]);
+        }
+    }
+    return true;
+}
+
+/**
+ * Keeps a child, unless it's a position already reached at no more cost
+ *@param child the new child
+ */
+void AnytimeSearch::add(State* child) {
+    State* seen = nodes.find(child);
+    if (seen != NULL && child->getG() >= seen->getG()) {
+        pool.release(child);
+        return;
+    }
+    Memo* m = memo(child);
+    m->round = 0;
+    m->waiting = false;
+    if (seen == NULL) {
+        nodes.insert(child);
+    } else {
+        // the cheaper copy takes over, the position keeps the round it was expanded in
+        nodes.replace(seen, child);
+        Memo* old = memo(seen);
+        m->round = old->round;
+        old->waiting = false;
+        if (old->open) { // never expanded, nothing points at it
+            Open entry = {seen->getG()+weight*seen->getH(), seen->getH(), seen};
+            open.erase(entry);
+            pool.release(seen);
+        } // an expanded copy stays, it's its children's parent
+    }
+
+    if (m->round == round) { // expanded this round already, it's not expanded again until the next
+        m->open = false;
+        m->waiting = true;
+        waiting.push_back(child);
+    } else {
+        queue(child);
+    }
+    if (child->getH() == 0 && (best == NULL || child->getG() < best->getG())) {
+        best = child;
+    }
+}
+
+/**
+ * Puts a state in the open list
+ *@param state the state
+ */
+void AnytimeSearch::queue(State* state) {
+    memo(state)->open = true;
+    Open entry = {state->getG()+weight*state->getH(), state->getH(), state};
+    open.insert(entry);
+}
+
+/**
+ * Works out the bound of the best solution
+ *@param finished whether or not the round was finished, so the weight bounds it too
+ */
+void AnytimeSearch::findBound(bool finished) {
+    if (best == NULL) {
+        return;
+    }
+    // every cheaper solution goes through a state open or waiting, at its cheapest g
+    int lowest = INT_MAX;
+    for (std::set<Open>::iterator i = open.begin(); i != open.end(); i++) {
+        if (i->state->getF() < lowest) {
+            lowest = i->state->getF();
+        }
+    }
+    for (unsigned int i = 0; i < waiting.size(); i++) {
+        if (memo(waiting[i])->waiting && waiting[i]->getF() < lowest) {
+            lowest = waiting[i]->getF();
+        }
+    }
+    bound = 1;
+    if (lowest < best->getG()) {
+        bound = (double)best->getG()/lowest;
+    }
+    if (finished && weight < bound) {
+        bound = weight;
+    }
+}
+
+/**
+ * Returns whether or not the time or state budget is used up
+ *@return true if the search has to stop
+ */
+bool AnytimeSearch::isOverBudget() {
+    return (limit && states >= limit) || (msec && getMsec() >= msec);
+}
+
+/**
+ * Returns a state's ARA* data
+ *@param state the state
+ *@return memo
+ */
+AnytimeSearch::Memo* AnytimeSearch::memo(State* state) {
+    return (Memo *)((char *)state+offset);
+}
@@ -0,0 +1,336 @@
+#include "batchsolver.h"
+#include "sokostar.h"
+#include "constants.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+/**
+ * Inits a batch
+ *@param threads how many levels to solve at once
+ */
+BatchSolver::BatchSolver(int threads) {
+    for (int i = 0; i < threads; i++) {
+        Worker* worker = new Worker();
+        worker->batch = this;
+        worker->id = i;
+        pthread_mutex_init(&worker->lock, NULL);
+        workers.push_back(worker);
+    }
+    pthread_mutex_init(&lock, NULL);
+    solved = 0;
+    budgetMsec = 0;
+    budgetStates = 0;
+}
+
+/**
+ * Frees the threads' queues
+ */
+BatchSolver::~BatchSolver() {
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        pthread_mutex_destroy(&workers[i]->lock);
+        delete workers[i];
+    }
+    pthread_mutex_destroy(&lock);
+}
+
+/**
+ * Sets a file to load deadlock patterns from before solving, and to save the ones learned to after
+ *@param _patternFile the file, empty to neither load nor save patterns
+ */
+void BatchSolver::setPatternFile(std::string& _patternFile) {
+    patternFile = _patternFile;
+}
+
+/**
+ * Sets a budget for each level, searching them with ARA* and taking the best solution found within it
+ *@param _msec how long a level may take, 0 for no limit
+ *@param _states how many states a level may expand, 0 for no limit. Both 0 searches with A*
+ */
+void BatchSolver::setBudget(int _msec, int _states) {
+    budgetMsec = _msec;
+    budgetStates = _states;
+}
+
+/**
+ * Reads the levels of a collection file, or of every file in a directory
+ *@param path the file or directory
+ *@return true if at least one level was found
+ */
+bool BatchSolver::load(char* path) {
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        printf("File %s not found\n", path);
+        return false;
+    }
+
+    if (S_ISDIR(info.st_mode)) {
+        DIR* dir = opendir(path);
+        if (dir == NULL) {
+            printf("Error reading directory %s\n", path);
+            return false;
+        }
+        std::vector<std::string> files;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] != '.') {
+                files.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+
+        std::sort(files.begin(), files.end());
+        for (unsigned int i = 0; i < files.size(); i++) {
+            std::string file = std::string(path)+"/"+files[i];
+            if (stat(file.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+                loadFile(file.c_str(), files[i]);
+            }
+        }
+    } else {
+        const char* name = strrchr(path, '/');
+        loadFile(path, name != NULL ? name+1 : path);
+    }
+
+    if (maps.empty()) {
+        printf("No levels found in %s\n", path);
+        return false;
+    }
+    printf("Loaded %d levels from %s\n", (int)maps.size(), path);
+
+    if (patternFile.empty()) {
+        return true;
+    }
+    int loaded = patterns.load(patternFile.c_str());
+    if (loaded) {
+        printf("Loaded %d deadlock patterns from %s\n", loaded, patternFile.c_str());
+    }
+    return true;
+}
+
+/**
+ * Solves every level, printing a row for each as it finishes and the totals at the end
+ *@return how many levels were solved
+ */
+int BatchSolver::solve() {
+    // deal the levels out in turn, collections tend to get harder towards the end
+    for (unsigned int i = 0; i < maps.size(); i++) {
+        workers[i%workers.size()]->levels.push_back(i);
+    }
+
+    printf("Solving with %d threads...\n\n", (int)workers.size());
+    printf("%-32s %-11s %7s %7s %10s %12s\n", "Level", "Result", "Pushes", "Moves", "States", "Msec");
+
+    struct timeval begin;
+    struct timeval end;
+    gettimeofday(&begin, NULL);
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        pthread_create(&workers[i]->thread, NULL, start, workers[i]);
+    }
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        pthread_join(workers[i]->thread, NULL);
+    }
+    gettimeofday(&end, NULL);
+    float seconds = (end.tv_sec-begin.tv_sec)+(end.tv_usec-begin.tv_usec)/1000000.f;
+
+    printf("\nSolved %d of %d levels in %f sec", solved, (int)maps.size(), seconds);
+    if (seconds > 0.f) {
+        printf(", %.2f levels/sec", maps.size()/seconds);
+    }
+    printf("\n");
+
+    int learned = patterns.getLearned();
+    if (patternFile.empty()) {
+        return solved;
+    }
+    if (learned && !patterns.save(patternFile.c_str())) {
+        printf("Error writing deadlock patterns to %s\n", patternFile.c_str());
+    } else if (learned) {
+        printf("Learned %d new deadlock patterns, %d now saved in %s\n", learned, patterns.size(), patternFile.c_str());
+    }
+    return solved;
+}
+
+/**
+ * Splits a collection file into its levels
+ *@param file the file
+ *@param name what to call its levels
+ *@return how many levels it had
+ */
+int BatchSolver::loadFile(const char* file, std::string name) {
+    FILE* f = fopen(file, "r");
+    if (f == NULL) {
+        printf("File %s not found\n", file);
+        return 0;
+    }
+
+    // a level is a run of map rows, anything else between them is a title or comment
+    std::vector<std::string> found;
+    std::string map = "";
+    std::string line = "";
+    int c;
+    do {
+        c = fgetc(f);
+        if (c != '\n' && c != EOF) {
+            if (c != '\r') {
+                line += (char)c;
+            }
+            continue;
+        }
+        if (isMapRow(line)) {
+            std::replace(line.begin(), line.end(), '-', EMPTY);
+            std::replace(line.begin(), line.end(), '_', EMPTY);
+            map += line+"\n";
+        } else if (!map.empty()) {
+            found.push_back(map);
+            map = "";
+        }
+        line = "";
+    } while (c != EOF);
+    if (!map.empty()) {
+        found.push_back(map);
+    }
+    fclose(f);
+
+    for (unsigned int i = 0; i < found.size(); i++) {
+        char number[16];
+        sprintf(number, "#%d", i+1);
+        names.push_back(found.size() > 1 ? name+number : name);
+        maps.push_back(found[i]);
+    }
+    return found.size();
+}
+
+/**
+ * Returns whether or not a line of a collection file is a map row, rather than a title or comment
+ *@param line the line, map rows may use - or _ for floor
+ *@return true if it's part of a map
+ */
+bool BatchSolver::isMapRow(std::string& line) {
+    if (line.find(WALL) == std::string::npos) {
+        return false;
+    }
+    for (unsigned int i = 0; i < line.size(); i++) {
+        switch (line[i]) {
+            case WALL:
+            case EMPTY:
+            case ROBOT:
+            case ROBOT_ON_GOAL:
+            case BLOCK:
+            case BLOCK_ON_GOAL:
+            case GOAL:
+            case '-':
+            case '_':
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Thread entry point
+ *@param worker the thread's worker
+ *@return NULL
+ */
+void* BatchSolver::start(void* worker) {
+    Worker* w = (Worker*)worker;
+    w->batch->run(w);
+    return NULL;
+}
+
+/**
+ * Solves levels until there are none left anywhere
+ *@param worker the thread's worker
+ */
+void BatchSolver::run(Worker* worker) {
+    int level;
+    while (take(worker, &level)) {
+        solveLevel(level);
+    }
+}
+
+/**
+ * Takes the next level off a thread's own queue, or steals one from the fullest other queue
+ *@param worker the thread's worker
+ *@param level (out) the level taken
+ *@return false if every queue is empty
+ */
+bool BatchSolver::take(Worker* worker, int* level) {
+    pthread_mutex_lock(&worker->lock);
+    bool found = !worker->levels.empty();
+    if (found) {
+        *level = worker->levels.front();
+        worker->levels.pop_front();
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    // thieves take from the far end, the levels the owner would have got to last
+    while (!found) {
+        Worker* victim = NULL;
+        unsigned int most = 0;
+        for (unsigned int i = 0; i < workers.size(); i++) {
+            if (workers[i] == worker) {
+                continue;
+            }
+            pthread_mutex_lock(&workers[i]->lock);
+            unsigned int size = workers[i]->levels.size(); // only a hint, it can be gone by the time we steal
+            pthread_mutex_unlock(&workers[i]->lock);
+            if (size > most) {
+                victim = workers[i];
+                most = size;
+            }
+        }
+        if (victim == NULL) {
+            return false; // levels are never added once solving starts
+        }
+        pthread_mutex_lock(&victim->lock);
+        found = !victim->levels.empty();
+        if (found) {
+            *level = victim->levels.back();
+            victim->levels.pop_back();
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return true;
+}
+
+/**
+ * Solves one level and prints its row
+ *@param level the level
+ */
+void BatchSolver::solveLevel(int level) {
+    SokoStar solver;
+    solver.setVerbose(false);
+    solver.setAnytime(budgetMsec, budgetStates);
+    bool loaded = solver.parse(maps[level]);
+    if (loaded) {
+        pthread_mutex_lock(&lock);
+        solver.getPatterns().merge(patterns);
+        pthread_mutex_unlock(&lock);
+        solver.solve();
+    }
+
+    pthread_mutex_lock(&lock);
+    if (!loaded) {
+        printf("%-32s %-11s %7s %7s %10s %12s\n", names[level].c_str(), "bad level", "-", "-", "-", "-");
+    } else {
+        patterns.merge(solver.getPatterns());
+        if (solver.isSolved()) {
+            solved++;
+            printf("%-32s %-11s %7d %7d %10d %12.3f\n", names[level].c_str(), "solved",
+                   solver.getPushCount(), solver.getMoveCount(), solver.getStates(), solver.getMsec());
+        } else if (solver.isOutOfBudget()) {
+            printf("%-32s %-11s %7s %7s %10d %12.3f\n", names[level].c_str(), "timeout",
+                   "-", "-", solver.getStates(), solver.getMsec());
+        } else {
+            printf("%-32s %-11s %7s %7s %10d %12.3f\n", names[level].c_str(), "no solution",
+                   "-", "-", solver.getStates(), solver.getMsec());
+        }
+    }
+    fflush(stdout);
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,164 @@
+#include "bidirectionalsearch.h"
+#include "constants.h"
+
+/**
+ * Inits a search
+ *@param _level the loaded level, without spare blocks
+ */
+BidirectionalSearch::BidirectionalSearch(Level& _level):
+        level(_level), reverse(_level), pool(State::getSize(_level.getBlocks().size())) {
+    reverse.reverse();
+    forward.level = &level;
+    backward.level = &reverse;
+    meetForward = NULL;
+    meetBackward = NULL;
+    states = 0;
+}
+
+/**
+ * Searches until the two searches meet, or either runs out of states
+ *@return true if a solution was found
+ */
+bool BidirectionalSearch::solve() {
+    add(forward, level.getStart(pool));
+    startBackward();
+
+    // either side running dry means there's no solution, every position it could reach was tried
+    while (meetForward == NULL && size(forward) && size(backward)) {
+        // grow whichever frontier is smaller, so neither side gets far ahead of the other
+        step(size(backward) < size(forward) ? backward : forward);
+    }
+    return meetForward != NULL;
+}
+
+/**
+ * Returns where the forward half of the solution ends
+ *@return the forward state, it lives as long as the search
+ */
+State* BidirectionalSearch::getForward() {
+    return meetForward;
+}
+
+/**
+ * Returns where the backward half of the solution starts, the same position as the forward state
+ *@return the backward state, NULL if the forward search reached the goals on its own
+ */
+State* BidirectionalSearch::getBackward() {
+    return meetBackward;
+}
+
+/**
+ * Returns how many states were expanded, both ways
+ *@return states
+ */
+int BidirectionalSearch::getStates() {
+    return states;
+}
+
+/**
+ * Builds the states the backward search starts from, one per robot region around the goals
+ */
+void BidirectionalSearch::startBackward() {
+    Workspace& workspace = reverse.getWorkspace();
+    std::vector<Block *>& goals = reverse.getBlocks(); // the reversed level keeps its blocks on the goals
+    int width = reverse.getWidth();
+    int cells = width*reverse.getHeight();
+    std::vector<int> blocks;
+    for (unsigned int i = 0; i < goals.size(); i++) {
+        blocks.push_back(goals[i]->getX()+goals[i]->getY()*width);
+        workspace.placeBlock(blocks[i], i);
+    }
+
+    // the robot can finish anywhere, so every region of free cells is a goal position of its own
+    std::vector<int> regions;
+    std::vector<char> covered(cells, 0);
+    for (int i = 0; i < cells; i++) {
+        if (reverse.getFloorIndex(i) == -1 || workspace.getBlock(i) != -1 || covered[i]) {
+            continue;
+        }
+        workspace.reach(i);
+        for (int j = i; j < cells; j++) {
+            if (workspace.isReached(j)) {
+                covered[j] = 1;
+            }
+        }
+        regions.push_back(i);
+    }
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        workspace.removeBlock(blocks[i]);
+    }
+
+    for (unsigned int i = 0; i < regions.size() && meetForward == NULL; i++) {
+        State* state = State::createBackward(pool, reverse, blocks, regions[i]);
+        if (state->getH() == DEAD_END) {
+            pool.release(state);
+        } else {
+            add(backward, state);
+        }
+    }
+}
+
+/**
+ * Adds a built state to the table and its side's open list, unless it's a duplicate
+ * or it meets a state of the other side
+ *@param side the side that built it
+ *@param state the state
+ */
+void BidirectionalSearch::add(Side& side, State* state) {
+    State* seen = nodes.find(state);
+    if (seen == NULL) {
+        nodes.insert(state);
+        side.openlist.push(state);
+    } else if (seen->isBackward() != state->isBackward()) { // the searches met
+        meetForward = state->isBackward() ? seen : state;
+        meetBackward = state->isBackward() ? state : seen;
+    } else if (seen->isOpen() && state->getG() < seen->getG()) {
+        // decrease-key, the cheaper copy takes the old one's heap and table slots
+        side.openlist.replace(seen, state);
+        nodes.replace(seen, state);
+        pool.release(seen);
+    } else { // already expanded, or no cheaper
+        pool.release(state);
+    }
+}
+
+/**
+ * Builds a push or expands a state, whichever is better
+ *@param side the side to step
+ */
+void BidirectionalSearch::step(Side& side) {
+    OpenList& openlist = side.openlist;
+    PushQueue& pushes = side.pushes;
+    if (!pushes.empty() && (openlist.empty() || pushes.top().f < openlist.top()->getF() ||
+            (pushes.top().f == openlist.top()->getF() && pushes.top().h < openlist.top()->getH()))) {
+        PushQueue::Push push = pushes.pop();
+        State* child = State::create(pool, *side.level, push.parent, push.block, push.direction, push.cost);
+        if (child->getH() == DEAD_END) { // never worth opening
+            pool.release(child);
+        } else {
+            add(side, child);
+        }
+        return;
+    }
+
+    State* current = openlist.pop();
+    states++;
+    if (!current->isBackward() && current->getH() == 0) { // got to the goals without meeting
+        meetForward = current;
+        return;
+    }
+    children.clear();
+    current->getPushes(&children, *side.level);
+    for (unsigned int i = 0; i < children.size(); i++) {
+        pushes.push(children[i]);
+    }
+}
+
+/**
+ * Returns how much a side still has to do
+ *@param side the side
+ *@return its open states and unbuilt pushes
+ */
+unsigned int BidirectionalSearch::size(Side& side) {
+    return side.openlist.size()+side.pushes.size();
+}
@@ -0,0 +1,247 @@
+#include "corral.h"
+#include "level.h"
+#include "state.h"
+#include "nodepool.h"
+#include "transpositiontable.h"
+#include "constants.h"
+
+#define SEARCH_LIMIT 500 /**< states the sub search may open before giving up */
+
+/**
+ * Inits an empty corral finder
+ */
+Corral::Corral() {
+    stamp = 0;
+    searching = false;
+}
+
+/**
+ * Sizes the grids for a level
+ *@param cells how many cells the level has
+ */
+void Corral::resize(int cells) {
+    areas.assign(cells, -1);
+    stamps.assign(cells, 0);
+    stamp = 0;
+}
+
+/**
+ * Looks for the unsolved PI-corral with the fewest pushes
+ * The blocks must be placed in the workspace and the robot region must be the reached cells
+ *@param level the level the state is in
+ *@param blocks the cells holding blocks
+ *@param count how many blocks there are
+ *@param pushable (in/out) the pushes per block, cut down to the corral's pushes if one is found
+ *@return how many pushes into the corral there are, -1 if there is no PI-corral
+ */
+int Corral::find(Level& level, unsigned short* blocks, unsigned int count, unsigned char* pushable) {
+    if (searching || level.hasSpareBlocks()) {
+        return -1;
+    }
+    Workspace& workspace = level.getWorkspace();
+
+    stamp++;
+    if (stamp == 0) { // wrapped around, old labels could look current
+        stamps.assign(stamps.size(), 0);
+        stamp = 1;
+    }
+    blockArea.assign(count, -1);
+
+    int best = -1;
+    int areaCount = 0;
+    std::vector<int> pushes;
+    std::vector<int> bestPushes;
+    for (unsigned int i = 0; i < count; i++) {
+        for (int dir = 0; dir < 4; dir++) {
+            int start = level.neighbour(blocks[i], dir);
+            if (start == -1 || workspace.getBlock(start) != -1 ||
+                    workspace.isReached(start) || stamps[start] == stamp) {
+                continue;
+            }
+            int id = areaCount++;
+            label(level, start, id);
+
+            // solved corrals don't need anything pushed into them
+            bool solved = true;
+            for (unsigned int j = 0; j < cells.size() && solved; j++) {
+                solved = level.getGoalAt(cells[j]) == -1;
+            }
+            for (unsigned int j = 0; j < around.size() && solved; j++) {
+                solved = level.getGoalAt(blocks[around[j]]) != -1;
+            }
+            if (solved) {
+                continue;
+            }
+
+            // every push a corral block could ever make before the corral opens up has to go
+            // into the corral (I), and has to be possible from where the robot is right now (P)
+            bool pi = true;
+            pushes.clear();
+            for (unsigned int j = 0; j < around.size() && pi; j++) {
+                int from = blocks[around[j]];
+                for (int push = 0; push < 4; push++) {
+                    int to = level.neighbour(from, push);
+                    int robot = level.neighbour(from, push^1);
+                    if (to == -1 || level.isDead(to) || robot == -1) {
+                        continue; // can never happen
+                    }
+                    int toBlock = workspace.getBlock(to);
+                    int robotBlock = workspace.getBlock(robot);
+                    if ((toBlock != -1 && blockArea[toBlock] == id) || (robotBlock != -1 && blockArea[robotBlock] == id)) {
+                        continue; // needs another corral block to move first
+                    }
+                    if (inArea(robot, id)) {
+                        continue; // the robot can't get inside before a corral block moves
+                    }
+                    if (toBlock == -1 && inArea(to, id) && robotBlock == -1 && workspace.isReached(robot)) {
+                        pushes.push_back(around[j]*4+push);
+                    } else {
+                        pi = false;
+                        break;
+                    }
+                }
+            }
+
+            if (pi && (best == -1 || pushes.size() < bestPushes.size())) {
+                best = id;
+                bestPushes.swap(pushes);
+                corralCells.swap(cells);
+                corralBlocks.clear();
+                for (unsigned int j = 0; j < around.size(); j++) {
+                    corralBlocks.push_back(blocks[around[j]]);
+                }
+            }
+        }
+    }
+
+    if (best == -1) {
+        corralBlocks.clear();
+        return -1;
+    }
+    corralId = best;
+    for (unsigned int i = 0; i < count; i++) {
+        pushable[i] = 0;
+    }
+    for (unsigned int i = 0; i < bestPushes.size(); i++) {
+        pushable[bestPushes[i]/4] |= 1 << (bestPushes[i]%4);
+    }
+    return bestPushes.size();
+}
+
+/**
+ * Tries to solve the last corral found with only its own blocks on the board
+ *@param level the level
+ *@param robot a cell the robot can reach
+ *@return true if it can't be done, so the state is deadlocked
+ */
+bool Corral::isDeadlocked(Level& level, int robot) {
+    if (corralBlocks.empty()) {
+        return false;
+    }
+
+    // removing every other block only makes the corral easier, so if it still can't be solved
+    // the real state can't be either
+    searching = true;
+    NodePool pool(State::getSize(corralBlocks.size()));
+    TranspositionTable seen;
+    std::vector<State *> queue;
+    std::vector<State *> children;
+    queue.push_back(State::create(pool, level, corralBlocks, robot));
+    seen.insert(queue[0]);
+
+    bool deadlocked = true;
+    for (unsigned int i = 0; i < queue.size(); i++) {
+        if (isResolved(level, queue[i]) || queue.size() > SEARCH_LIMIT) {
+            deadlocked = false;
+            break;
+        }
+        children.clear();
+        queue[i]->getChildren(&children, level, pool);
+        for (unsigned int j = 0; j < children.size(); j++) {
+            if (seen.find(children[j]) == NULL) {
+                seen.insert(children[j]);
+                queue.push_back(children[j]);
+            } else {
+                pool.release(children[j]);
+            }
+        }
+    }
+    searching = false;
+    return deadlocked;
+}
+
+/**
+ * Labels the area of unreachable cells connected to a cell
+ *@param level the level
+ *@param index the first cell
+ *@param id the label to give the area
+ */
+void Corral::label(Level& level, int index, int id) {
+    Workspace& workspace = level.getWorkspace();
+    cells.clear();
+    around.clear();
+    cells.push_back(index);
+    areas[index] = id;
+    stamps[index] = stamp;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        for (int dir = 0; dir < 4; dir++) {
+            int next = level.neighbour(cells[i], dir);
+            if (next == -1) {
+                continue;
+            }
+            int block = workspace.getBlock(next);
+            if (block != -1) {
+                if (blockArea[block] != id) {
+                    blockArea[block] = id;
+                    around.push_back(block);
+                }
+            } else if (stamps[next] != stamp) {
+                // the robot can't be next to the area, so every free neighbour is unreachable too
+                areas[next] = id;
+                stamps[next] = stamp;
+                cells.push_back(next);
+            }
+        }
+    }
+}
+
+/**
+ * Returns whether or not a cell is in an area
+ *@param index the cell
+ *@param id the area's label
+ *@return true if the cell has this label
+ */
+bool Corral::inArea(int index, int id) {
+    return stamps[index] == stamp && areas[index] == id;
+}
+
+/**
+ * Returns whether or not a state of the sub search has resolved the corral,
+ * either with every block on a goal or the robot getting inside it
+ *@param level the level
+ *@param state the sub search state
+ *@return true if the corral can't be proven deadlocked from here
+ */
+bool Corral::isResolved(Level& level, State* state) {
+    bool solved = true;
+    for (int i = 0; i < state->getBlockCount() && solved; i++) {
+        solved = level.getGoalAt(state->getBlock(i)) != -1;
+    }
+    if (solved) {
+        return true;
+    }
+
+    Workspace& workspace = level.getWorkspace();
+    for (int i = 0; i < state->getBlockCount(); i++) {
+        workspace.placeBlock(state->getBlock(i), i);
+    }
+    workspace.reach(state->getRegion());
+    bool inside = false;
+    for (unsigned int i = 0; i < corralCells.size() && !inside; i++) {
+        inside = workspace.isReached(corralCells[i]);
+    }
+    for (int i = 0; i < state->getBlockCount(); i++) {
+        workspace.removeBlock(state->getBlock(i));
+    }
+    return inside;
+}
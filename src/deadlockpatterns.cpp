@@ -0,0 +1,474 @@
+#include "deadlockpatterns.h"
+#include "level.h"
+#include "workspace.h"
+#include "constants.h"
+#include <cstdio>
+#include <cstring>
+
+#define WINDOW 5 /**< the window is WINDOW x WINDOW cells around the pushed block */
+#define CENTRE (WINDOW*WINDOW/2)
+#define OUTSIDE (WINDOW*WINDOW) /**< where the robot is anywhere around the window */
+#define SEARCH_LIMIT 500 /**< positions the window search may reach before giving up */
+
+// a base 5 digit per window cell, then where the robot is on top, 5^25*26 fits in 64 bits
+#define CELL_FLOOR         0
+#define CELL_WALL          1
+#define CELL_BLOCK         2
+#define CELL_BLOCK_ON_GOAL 3
+#define CELL_GOAL          4
+#define CELL_CODES         5
+
+#define FILE_MAGIC   "SKDP"
+#define FILE_VERSION 2
+
+/**
+ * Inits an empty pattern store
+ */
+DeadlockPatterns::DeadlockPatterns() {
+    table.assign(1024, 0);
+    used = 0;
+    learned = 0;
+
+    // bit 0 mirrors x, bit 1 mirrors y, bit 2 swaps the axes
+    for (int s = 0; s < 8; s++) {
+        for (int y = 0; y < WINDOW; y++) {
+            for (int x = 0; x < WINDOW; x++) {
+                int dx = x-WINDOW/2;
+                int dy = y-WINDOW/2;
+                if (s & 4) {
+                    int t = dx;
+                    dx = dy;
+                    dy = t;
+                }
+                if (s & 1) {
+                    dx = -dx;
+                }
+                if (s & 2) {
+                    dy = -dy;
+                }
+                symmetries[s][x+y*WINDOW] = dx+WINDOW/2+(dy+WINDOW/2)*WINDOW;
+            }
+        }
+    }
+}
+
+/**
+ * Reads patterns saved by an earlier run
+ *@param file the file to read
+ *@return how many patterns were read, 0 if the file is missing or not a pattern file
+ */
+int DeadlockPatterns::load(const char* file) {
+    FILE* f = fopen(file, "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    char magic[4];
+    uint32_t header[2];
+    int read = 0;
+    if (fread(magic, 1, 4, f) == 4 && !memcmp(magic, FILE_MAGIC, 4) &&
+            fread(header, sizeof(uint32_t), 2, f) == 2 && header[0] == FILE_VERSION) {
+        uint64_t window;
+        for (uint32_t i = 0; i < header[1] && fread(&window, sizeof(uint64_t), 1, f) == 1; i++) {
+            if (!contains(window) && isDeadlocked(window)) { // don't trust a damaged file to prune
+                add(window);
+                read++;
+            }
+        }
+    } else {
+        printf("%s is not a deadlock pattern file, ignoring it\n", file);
+    }
+    fclose(f);
+    return read;
+}
+
+/**
+ * Writes every known pattern to a file, if any were learned since loading
+ *@param file the file to write
+ *@return true on success, or if there was nothing new to write
+ */
+bool DeadlockPatterns::save(const char* file) {
+    if (!learned) {
+        return true;
+    }
+    FILE* f = fopen(file, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    uint32_t header[2] = {FILE_VERSION, (uint32_t)patterns.size()};
+    bool ok = fwrite(FILE_MAGIC, 1, 4, f) == 4 &&
+              fwrite(header, sizeof(uint32_t), 2, f) == 2 &&
+              fwrite(&patterns[0], sizeof(uint64_t), patterns.size(), f) == patterns.size();
+    fclose(f);
+    if (ok) {
+        learned = 0;
+    }
+    return ok;
+}
+
+/**
+ * Encodes the window around a cell, the blocks must be placed in the workspace
+ *@param level the level
+ *@param index the centre cell
+ *@param robot any cell the robot can walk to
+ *@return the window
+ */
+uint64_t DeadlockPatterns::encode(Level& level, int index, int robot) {
+    Workspace& workspace = level.getWorkspace();
+    std::string& walls = level.getWallMap();
+    int width = level.getWidth();
+    int height = level.getHeight();
+    int cx = index%width;
+    int cy = index/width;
+    unsigned char cells[WINDOW*WINDOW];
+    int inside = OUTSIDE;
+    int cell = 0;
+    for (int y = cy-WINDOW/2; y <= cy+WINDOW/2; y++) {
+        for (int x = cx-WINDOW/2; x <= cx+WINDOW/2; x++) {
+            cells[cell] = CELL_WALL; // off the map
+            if (x >= 0 && y >= 0 && x < width && y < height) {
+                int i = x+y*width;
+                bool goal = level.getGoalAt(i) != -1;
+                if (walls[i] == WALL) {
+                    cells[cell] = CELL_WALL;
+                } else if (workspace.getBlock(i) != -1) {
+                    cells[cell] = goal ? CELL_BLOCK_ON_GOAL : CELL_BLOCK;
+                } else {
+                    cells[cell] = goal ? CELL_GOAL : CELL_FLOOR;
+                }
+                if (i == robot) {
+                    inside = cell;
+                }
+            }
+            cell++;
+        }
+    }
+    return pack(cells, inside);
+}
+
+/**
+ * Returns whether or not a window is a known deadlock
+ *@param window the encoded window
+ *@return true if it can never be solved
+ */
+bool DeadlockPatterns::contains(uint64_t window) {
+    unsigned int mask = table.size()-1;
+    for (unsigned int i = slot(window); table[i] != 0; i = (i+1) & mask) {
+        if (table[i] == window) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Keeps a window a corral sub search found deadlocked, if it's deadlocked without the rest of its level
+ *@param window the encoded window
+ *@return true if it was added
+ */
+bool DeadlockPatterns::learn(uint64_t window) {
+    // dead squares, goals and walls further out may have helped prove it, only keep it if the window is enough
+    if (contains(window) || rejected.count(window)) {
+        return false;
+    }
+    if (!isDeadlocked(window)) {
+        rejected.insert(window);
+        return false;
+    }
+    add(window);
+    learned++;
+    return true;
+}
+
+/**
+ * Takes in the patterns another store learned
+ *@param other the other store
+ *@return how many were new here
+ */
+int DeadlockPatterns::merge(DeadlockPatterns& other) {
+    int added = 0;
+    for (unsigned int i = 0; i < other.patterns.size(); i++) {
+        if (!contains(other.patterns[i])) {
+            add(other.patterns[i]);
+            added++;
+        }
+    }
+    learned += added;
+    return added;
+}
+
+/**
+ * Returns how many patterns are known
+ *@return the number of distinct patterns, not counting rotations and mirrors
+ */
+int DeadlockPatterns::size() {
+    return patterns.size();
+}
+
+/**
+ * Returns how many patterns were learned since loading
+ *@return learned
+ */
+int DeadlockPatterns::getLearned() {
+    return learned;
+}
+
+/**
+ * Returns a window turned or mirrored
+ *@param window the encoded window
+ *@param symmetry which of the 8 symmetries
+ *@return the transformed window
+ */
+uint64_t DeadlockPatterns::transform(uint64_t window, int symmetry) {
+    unsigned char cells[WINDOW*WINDOW];
+    unsigned char turned[WINDOW*WINDOW];
+    int robot = decode(window, cells);
+    int moved = OUTSIDE;
+    for (int i = 0; i < WINDOW*WINDOW; i++) {
+        turned[i] = cells[symmetries[symmetry][i]];
+        if (symmetries[symmetry][i] == robot) {
+            moved = i;
+        }
+    }
+    return pack(turned, moved);
+}
+
+/**
+ * Adds a pattern and its rotations and mirrors to the lookup table
+ *@param window the encoded window
+ */
+void DeadlockPatterns::add(uint64_t window) {
+    patterns.push_back(window);
+    for (int s = 0; s < 8; s++) {
+        uint64_t turned = transform(window, s);
+        if (!contains(turned)) { // symmetric patterns map onto themselves
+            insert(turned);
+        }
+    }
+}
+
+/**
+ * Puts a window in the lookup table, growing it once it's half full
+ *@param window the encoded window, not already in the table
+ */
+void DeadlockPatterns::insert(uint64_t window) {
+    if ((used+1)*2 > table.size()) {
+        std::vector<uint64_t> old;
+        old.swap(table);
+        table.assign(old.size()*2, 0);
+        used = 0;
+        for (unsigned int i = 0; i < old.size(); i++) {
+            if (old[i] != 0) {
+                insert(old[i]);
+            }
+        }
+    }
+    unsigned int mask = table.size()-1;
+    unsigned int i = slot(window);
+    while (table[i] != 0) {
+        i = (i+1) & mask;
+    }
+    table[i] = window;
+    used++;
+}
+
+/**
+ * Returns the table slot a window's probe starts at
+ *@param window the encoded window
+ *@return the slot
+ */
+unsigned int DeadlockPatterns::slot(uint64_t window) {
+    return (window*0x9e3779b97f4a7c15ULL) >> 32 & (table.size()-1);
+}
+
+/**
+ * Returns whether or not a window can never get its blocks onto goals or out of it,
+ * with the cells outside the window free floor
+ *@param window the encoded window
+ *@return true if the window is deadlocked in any level, false if not or the search gave up
+ */
+bool DeadlockPatterns::isDeadlocked(uint64_t window) {
+    unsigned char cells[WINDOW*WINDOW];
+    int robot = decode(window, cells);
+    if (cells[CENTRE] != CELL_BLOCK && cells[CENTRE] != CELL_BLOCK_ON_GOAL) {
+        return false;
+    }
+    uint32_t walls = 0;
+    uint32_t goals = 0;
+    uint32_t blocks = 0;
+    for (int i = 0; i < WINDOW*WINDOW; i++) {
+        if (cells[i] == CELL_WALL) {
+            walls |= 1 << i;
+        }
+        if (cells[i] == CELL_GOAL || cells[i] == CELL_BLOCK_ON_GOAL) {
+            goals |= 1 << i;
+        }
+        if (cells[i] == CELL_BLOCK || cells[i] == CELL_BLOCK_ON_GOAL) {
+            blocks |= 1 << i;
+        }
+    }
+
+    // a position is its blocks and the robot's area, like the window's robot digit.
+    // Walls and blocks outside the window would only get in the way, and a block that leaves could
+    // reach a goal out there, so proving the window stuck without them proves it stuck anywhere
+    std::set<uint64_t> seen;
+    std::vector<uint64_t> queue;
+    queue.push_back(blocks | (uint64_t)robot << OUTSIDE);
+    seen.insert(queue[0]);
+
+    for (unsigned int i = 0; i < queue.size(); i++) {
+        uint32_t at = queue[i] & ((1 << OUTSIDE)-1);
+        int start = queue[i] >> OUTSIDE;
+        if (!(at & ~goals)) { // every block left is on a goal
+            return false;
+        }
+        bool outside = false;
+        uint32_t reached = reach(walls, at, start, &outside);
+        for (int block = 0; block < WINDOW*WINDOW; block++) {
+            if (!(at >> block & 1)) {
+                continue;
+            }
+            for (int dir = 0; dir < 4; dir++) {
+                int behind = step(block, dir^1); // UP^1 == DOWN, LEFT^1 == RIGHT
+                if (behind == OUTSIDE ? !outside : !(reached >> behind & 1)) {
+                    continue;
+                }
+                int to = step(block, dir);
+                uint32_t next = at & ~(1 << block);
+                if (to != OUTSIDE) {
+                    if ((walls | at) >> to & 1) {
+                        continue;
+                    }
+                    next |= 1 << to;
+                }
+                uint64_t position = next | (uint64_t)area(walls, next, block) << OUTSIDE;
+                if (seen.insert(position).second) {
+                    if (seen.size() > SEARCH_LIMIT) {
+                        return false;
+                    }
+                    queue.push_back(position);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Splits a window into its cells
+ *@param window the encoded window
+ *@param cells (out) WINDOW*WINDOW cell codes
+ *@return the robot's area, the lowest cell in it or OUTSIDE
+ */
+int DeadlockPatterns::decode(uint64_t window, unsigned char* cells) {
+    for (int i = 0; i < WINDOW*WINDOW; i++) {
+        cells[i] = window%CELL_CODES;
+        window /= CELL_CODES;
+    }
+    return window;
+}
+
+/**
+ * Joins cells into a window
+ *@param cells WINDOW*WINDOW cell codes
+ *@param robot a cell the robot can walk to, OUTSIDE if it's not in the window
+ *@return the encoded window
+ */
+uint64_t DeadlockPatterns::pack(unsigned char* cells, int robot) {
+    uint32_t walls = 0;
+    uint32_t blocks = 0;
+    for (int i = 0; i < WINDOW*WINDOW; i++) {
+        if (cells[i] == CELL_WALL) {
+            walls |= 1 << i;
+        } else if (cells[i] == CELL_BLOCK || cells[i] == CELL_BLOCK_ON_GOAL) {
+            blocks |= 1 << i;
+        }
+    }
+    // the same area always packs the same, wherever in it the robot is
+    uint64_t window = area(walls, blocks, robot);
+    for (int i = WINDOW*WINDOW-1; i >= 0; i--) {
+        window = window*CELL_CODES+cells[i];
+    }
+    return window;
+}
+
+/**
+ * Returns the robot's area in the window, going round outside it where the window's edges are free
+ *@param walls a bit per wall cell
+ *@param blocks a bit per block cell
+ *@param robot the robot's cell, OUTSIDE for around the window
+ *@return the lowest cell it can walk to, or OUTSIDE if it can get out of the window
+ */
+int DeadlockPatterns::area(uint32_t walls, uint32_t blocks, int robot) {
+    bool outside = false;
+    uint32_t reached = reach(walls, blocks, robot, &outside);
+    return outside ? OUTSIDE : __builtin_ctz(reached);
+}
+
+/**
+ * Returns the window cell next to another one
+ *@param cell the cell, OUTSIDE for anywhere around the window
+ *@param direction the direction to step
+ *@return the cell, OUTSIDE when it leaves the window
+ */
+int DeadlockPatterns::step(int cell, int direction) {
+    int x = cell%WINDOW;
+    int y = cell/WINDOW;
+    switch (direction) {
+        case UP:
+            y--;
+            break;
+        case DOWN:
+            y++;
+            break;
+        case LEFT:
+            x--;
+            break;
+        case RIGHT:
+            x++;
+            break;
+    }
+    if (x < 0 || y < 0 || x >= WINDOW || y >= WINDOW) {
+        return OUTSIDE;
+    }
+    return x+y*WINDOW;
+}
+
+/**
+ * Finds the window cells the robot can walk to
+ *@param walls a bit per wall cell
+ *@param blocks a bit per block cell
+ *@param start the robot's cell, OUTSIDE for around the window
+ *@param outside (out) whether or not it can get out of the window
+ *@return a bit per reached cell
+ */
+uint32_t DeadlockPatterns::reach(uint32_t walls, uint32_t blocks, int start, bool* outside) {
+    // a bit per cell, so the whole window steps at once
+    uint32_t all = (1 << WINDOW*WINDOW)-1;
+    uint32_t left = 0;
+    uint32_t top = (1 << WINDOW)-1;
+    for (int y = 0; y < WINDOW; y++) {
+        left |= 1 << y*WINDOW;
+    }
+    uint32_t right = left << (WINDOW-1);
+    uint32_t bottom = top << (WINDOW*(WINDOW-1));
+    uint32_t edges = left | right | top | bottom;
+    uint32_t space = all & ~(walls | blocks);
+
+    *outside = start == OUTSIDE;
+    uint32_t reached = start == OUTSIDE ? 0 : 1 << start;
+    while (true) {
+        if (reached & edges) {
+            *outside = true;
+        }
+        uint32_t next = reached;
+        if (*outside) { // outside the window is one free area, every free edge cell is reached with it
+            next |= edges;
+        }
+        next |= (reached & ~left) >> 1 | (reached & ~right) << 1 | reached >> WINDOW | (reached << WINDOW & all);
+        next &= space;
+        if (next == reached) {
+            return reached;
+        }
+        reached = next;
+    }
+}
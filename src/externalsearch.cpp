@@ -0,0 +1,388 @@
+#include "externalsearch.h"
+#include "constants.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+#define BUFFER_BYTES (64*1024*1024) /**< how much the buckets buffer before they're written out */
+
+/**
+ * Inits a search
+ *@param _level the loaded level
+ *@param _directory where to keep the files, it must exist
+ */
+ExternalSearch::ExternalSearch(Level& _level, std::string& _directory):
+        level(_level), directory(_directory), pool(State::getSize(_level.getBlocks().size())) {
+    blocks = level.getBlocks().size();
+    keyBytes = (blocks+1)*sizeof(unsigned short);
+    recordBytes = keyBytes+sizeof(Data);
+    buffered = 0;
+    failed = false;
+    states = 0;
+}
+
+/**
+ * Deletes the files the search made
+ */
+ExternalSearch::~ExternalSearch() {
+    for (unsigned int i = 0; i < files.size(); i++) {
+        unlink(files[i].c_str());
+    }
+}
+
+/**
+ * Searches until the cheapest solution is found or the level is proven to have none
+ *@return the goal state, NULL if there's no solution or the files couldn't be used.
+ * It lives as long as the search
+ */
+State* ExternalSearch::solve() {
+    State* root = level.getStart(pool);
+    if (root->getH() == DEAD_END) {
+        return NULL;
+    }
+    if (root->getH() == 0) {
+        return root;
+    }
+    add(root, NULL);
+    pool.release(root);
+
+    while (!open.empty() && !failed) {
+        std::map<std::pair<int, int>, Bucket>::iterator cheapest = open.begin();
+        int g = cheapest->first.second;
+        int h = cheapest->first.first-g;
+        Bucket bucket;
+        bucket.buffer.swap(cheapest->second.buffer);
+        bucket.runs.swap(cheapest->second.runs);
+        open.erase(cheapest); // a push always costs something, its children never go back in it
+
+        std::vector<unsigned char> goal;
+        if (expand(g, h, bucket, &goal)) {
+            return buildPath(&goal[0]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Returns whether or not the search stopped because the files couldn't be used
+ *@return true on a file error
+ */
+bool ExternalSearch::hasFailed() {
+    return failed;
+}
+
+/**
+ * Returns how many states were expanded
+ *@return states
+ */
+int ExternalSearch::getStates() {
+    return states;
+}
+
+/**
+ * Compares the keys of two records
+ *@param a a record
+ *@param b another record
+ *@return true if a's key goes first
+ */
+bool ExternalSearch::KeyOrder::operator()(unsigned char* a, unsigned char* b) const {
+    return memcmp(a, b, bytes) < 0;
+}
+
+/**
+ * Adds a state to its bucket, writing buckets out when too much is buffered
+ *@param state the state
+ *@param parent the state it was pushed from, NULL for none
+ */
+void ExternalSearch::add(State* state, State* parent) {
+    Data data;
+    data.g = state->getG();
+    data.moved = state->getMoved();
+    data.parent = parent != NULL ? parent->getHash() : 0;
+    data.parentG = parent != NULL ? parent->getG() : 0;
+    data.parentH = parent != NULL ? parent->getH() : 0;
+
+    Bucket& bucket = open[std::make_pair(data.g+state->getH(), data.g)];
+    size_t at = bucket.buffer.size();
+    bucket.buffer.resize(at+recordBytes);
+    encode(state, &bucket.buffer[at]);
+    memcpy(&bucket.buffer[at+keyBytes], &data, sizeof(Data));
+    buffered += recordBytes;
+
+    if (buffered > BUFFER_BYTES) {
+        for (std::map<std::pair<int, int>, Bucket>::iterator i = open.begin(); i != open.end(); i++) {
+            flush(i->second);
+        }
+    }
+}
+
+/**
+ * Writes a bucket's buffered records out as a sorted run
+ *@param bucket the bucket
+ */
+void ExternalSearch::flush(Bucket& bucket) {
+    if (bucket.buffer.empty()) {
+        return;
+    }
+    std::vector<unsigned char *> records;
+    for (size_t i = 0; i < bucket.buffer.size(); i += recordBytes) {
+        records.push_back(&bucket.buffer[i]);
+    }
+    KeyOrder order = {keyBytes};
+    std::sort(records.begin(), records.end(), order);
+
+    std::string path = newPath();
+    RunFile run(keyBytes, sizeof(Data));
+    if (!run.create(path)) {
+        failed = true;
+        return;
+    }
+    for (unsigned int i = 0; i < records.size(); i++) {
+        // the whole bucket has the same g, any copy will do
+        if (i == 0 || memcmp(records[i], records[i-1], keyBytes)) {
+            run.append(records[i]);
+        }
+    }
+    if (!run.close()) {
+        failed = true;
+    }
+    bucket.runs.push_back(path);
+    buffered -= bucket.buffer.size();
+    std::vector<unsigned char>().swap(bucket.buffer);
+}
+
+/**
+ * Merges a bucket's runs, drops what was already expanded and expands the rest
+ *@param g the bucket's g
+ *@param h the bucket's h
+ *@param bucket the bucket, it's been taken out of the open buckets
+ *@param goal (out) the goal record, if the bucket had one
+ *@return true if a goal was found
+ */
+bool ExternalSearch::expand(int g, int h, Bucket& bucket, std::vector<unsigned char>* goal) {
+    flush(bucket);
+    std::vector<RunFile *> runs;
+    std::vector<unsigned char *> heads;
+    for (unsigned int i = 0; i < bucket.runs.size(); i++) {
+        runs.push_back(new RunFile(keyBytes, sizeof(Data)));
+        if (!runs[i]->open(bucket.runs[i])) {
+            failed = true;
+        }
+        heads.push_back(runs[i]->next());
+    }
+    // a position always has the same h, so only buckets with this h can hold it already
+    std::vector<RunFile *> expanded;
+    std::vector<unsigned char *> expandedHeads;
+    std::vector<Closed>& done = closed[h];
+    for (unsigned int i = 0; i < done.size(); i++) {
+        if (done[i].g <= g) {
+            expanded.push_back(new RunFile(keyBytes, sizeof(Data)));
+            if (!expanded.back()->open(done[i].path)) {
+                failed = true;
+            }
+            expandedHeads.push_back(expanded.back()->next());
+        }
+    }
+    Closed result = {g, newPath()};
+    RunFile out(keyBytes, sizeof(Data));
+    if (!out.create(result.path)) {
+        failed = true;
+    }
+
+    std::vector<unsigned char> record(recordBytes);
+    bool found = false;
+    while (!found && !failed) {
+        int first = -1;
+        for (unsigned int i = 0; i < runs.size(); i++) {
+            if (heads[i] != NULL && (first == -1 || memcmp(heads[i], heads[first], keyBytes) < 0)) {
+                first = i;
+            }
+        }
+        if (first == -1) {
+            break;
+        }
+        memcpy(&record[0], heads[first], recordBytes);
+        for (unsigned int i = 0; i < runs.size(); i++) {
+            while (heads[i] != NULL && !memcmp(heads[i], &record[0], keyBytes)) {
+                heads[i] = runs[i]->next();
+            }
+        }
+
+        bool known = false;
+        for (unsigned int i = 0; i < expanded.size(); i++) {
+            while (expandedHeads[i] != NULL && memcmp(expandedHeads[i], &record[0], keyBytes) < 0) {
+                expandedHeads[i] = expanded[i]->next();
+            }
+            if (expandedHeads[i] != NULL && !memcmp(expandedHeads[i], &record[0], keyBytes)) {
+                known = true;
+            }
+        }
+        if (known) {
+            continue;
+        }
+
+        out.append(&record[0]);
+        if (h == 0) { // nothing open is cheaper
+            goal->assign(record.begin(), record.end());
+            found = true;
+            break;
+        }
+        State* state = rebuild(&record[0]);
+        std::vector<State *> children;
+        state->getChildren(&children, level, pool);
+        for (unsigned int i = 0; i < children.size(); i++) {
+            add(children[i], state);
+            pool.release(children[i]);
+        }
+        pool.release(state);
+        states++;
+    }
+
+    for (unsigned int i = 0; i < runs.size(); i++) {
+        delete runs[i];
+        unlink(bucket.runs[i].c_str()); // merged into the closed run
+    }
+    for (unsigned int i = 0; i < expanded.size(); i++) {
+        delete expanded[i];
+    }
+    if (!out.close()) {
+        failed = true;
+    }
+    done.push_back(result);
+    return found;
+}
+
+/**
+ * Builds the state a record holds
+ *@param record the record
+ *@return the state, in the pool
+ */
+State* ExternalSearch::rebuild(unsigned char* record) {
+    std::vector<int> cells(blocks);
+    unsigned short cell;
+    for (unsigned int i = 0; i < blocks; i++) {
+        memcpy(&cell, record+i*sizeof(unsigned short), sizeof(unsigned short));
+        cells[i] = cell;
+    }
+    memcpy(&cell, record+blocks*sizeof(unsigned short), sizeof(unsigned short));
+    Data data;
+    memcpy(&data, record+keyBytes, sizeof(Data));
+    return State::create(pool, level, cells, cell, data.g, data.moved);
+}
+
+/**
+ * Finds the path to a goal record back through the parents' buckets, and builds it in the pool
+ *@param goal the goal record
+ *@return the goal state, with its parents up to the start state
+ */
+State* ExternalSearch::buildPath(unsigned char* goal) {
+    // the records on the path, from the goal back to the start state
+    std::vector<std::vector<unsigned char> > path;
+    std::vector<unsigned char> record(goal, goal+recordBytes);
+    while (true) {
+        path.push_back(record);
+        Data data;
+        memcpy(&data, &record[keyBytes], sizeof(Data));
+        if (data.parent == 0) {
+            break;
+        }
+        // a bucket is only expanded once, so the parent is in the one closed run with its g and h
+        bool found = false;
+        std::vector<Closed>& done = closed[data.parentH];
+        for (unsigned int i = 0; i < done.size() && !found; i++) {
+            if (done[i].g != data.parentG) {
+                continue;
+            }
+            RunFile run(keyBytes, sizeof(Data));
+            if (!run.open(done[i].path)) {
+                failed = true;
+                return NULL;
+            }
+            unsigned char* next;
+            while ((next = run.next()) != NULL) {
+                if (hashOf(next) == data.parent) {
+                    record.assign(next, next+recordBytes);
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found) {
+            failed = true;
+            return NULL;
+        }
+    }
+
+    // push along the path again from the start state, so each state gets its parent
+    State* state = level.getStart(pool);
+    std::vector<unsigned char> key(keyBytes);
+    for (int i = (int)path.size()-2; i >= 0; i--) {
+        std::vector<State *> children;
+        state->getChildren(&children, level, pool);
+        State* next = NULL;
+        for (unsigned int j = 0; j < children.size(); j++) {
+            encode(children[j], &key[0]);
+            if (next == NULL && !memcmp(&key[0], &path[i][0], keyBytes)) {
+                next = children[j];
+            } else {
+                pool.release(children[j]);
+            }
+        }
+        if (next == NULL) {
+            failed = true;
+            return NULL;
+        }
+        state = next;
+    }
+    return state;
+}
+
+/**
+ * Writes a state's key: its block cells and its robot region
+ *@param state the state
+ *@param key (out) where to write it
+ */
+void ExternalSearch::encode(State* state, unsigned char* key) {
+    unsigned short cell;
+    for (unsigned int i = 0; i < blocks; i++) {
+        cell = state->getBlock(i);
+        memcpy(key+i*sizeof(unsigned short), &cell, sizeof(unsigned short));
+    }
+    cell = state->getRegion();
+    memcpy(key+blocks*sizeof(unsigned short), &cell, sizeof(unsigned short));
+}
+
+/**
+ * Returns the hash of the state a key belongs to
+ *@param key the key
+ *@return hash
+ */
+uint64_t ExternalSearch::hashOf(unsigned char* key) {
+    uint64_t hash = 0;
+    unsigned short cell;
+    for (unsigned int i = 0; i < blocks; i++) {
+        memcpy(&cell, key+i*sizeof(unsigned short), sizeof(unsigned short));
+        hash ^= level.getBlockHash(cell);
+    }
+    memcpy(&cell, key+blocks*sizeof(unsigned short), sizeof(unsigned short));
+    return hash^level.getRobotHash(cell);
+}
+
+/**
+ * Makes a new file in the directory, named so no other search can pick it too
+ *@return path, empty if it couldn't be made
+ */
+std::string ExternalSearch::newPath() {
+    // other runs may share the directory, mkstemp makes sure the name is ours
+    std::string name = directory+"/sokostar.XXXXXX";
+    std::vector<char> path(name.begin(), name.end());
+    path.push_back(0);
+    int file = mkstemp(&path[0]);
+    if (file == -1) {
+        return "";
+    }
+    close(file);
+    files.push_back(&path[0]);
+    return files.back();
+}
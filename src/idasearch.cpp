@@ -0,0 +1,154 @@
+#include "idasearch.h"
+#include "constants.h"
+#include <algorithm>
+#include <climits>
+
+#define BUCKET 2 /**< entries per table bucket */
+
+/**
+ * Inits a search
+ *@param _level the loaded level
+ *@param megabytes how big the transposition table is
+ */
+IdaSearch::IdaSearch(Level& _level, unsigned int megabytes):
+        level(_level), pool(State::getSize(_level.getBlocks().size())) {
+    uint64_t wanted = (uint64_t)megabytes*1024*1024/(BUCKET*sizeof(Entry));
+    if (wanted > table.max_size()/BUCKET) { // more than can be addressed, as big as it can be
+        wanted = table.max_size()/BUCKET;
+    }
+    buckets = wanted > 0 ? (size_t)wanted : 1;
+    Entry empty = {0, 0, 0, 0};
+    table.assign(buckets*BUCKET, empty);
+    iteration = 0;
+    states = 0;
+}
+
+/**
+ * Deepens until a solution is found or the level is proven to have none
+ *@return the goal state, NULL if the level has no solution. It lives as long as the search
+ */
+State* IdaSearch::solve() {
+    State* root = level.getStart(pool);
+    if (root->getH() == DEAD_END) {
+        return NULL;
+    }
+    int bound = root->getF();
+    while (true) {
+        iteration++; // makes every entry stale without clearing the table
+        int next = INT_MAX;
+        State* goal = search(root, bound, &next);
+        if (goal != NULL) {
+            return goal;
+        }
+        if (next == INT_MAX) { // nothing was cut off, everything was searched
+            return NULL;
+        }
+        bound = next;
+    }
+}
+
+/**
+ * Returns how many states were expanded, over all iterations
+ *@return states
+ */
+int IdaSearch::getStates() {
+    return states;
+}
+
+/**
+ * Searches below a state, as long as f stays within the bound
+ *@param state the state
+ *@param bound the f bound of this iteration
+ *@param next (in/out) the smallest f over the bound so far
+ *@return the goal state, NULL if there's none within the bound
+ */
+State* IdaSearch::search(State* state, int bound, int* next) {
+    int f = state->getF();
+    if (f > bound) {
+        if (f < *next) {
+            *next = f;
+        }
+        return NULL;
+    }
+    if (state->getH() == 0) { // goal
+        return state;
+    }
+    if (isKnown(state)) {
+        return NULL;
+    }
+
+    states++;
+    std::vector<State *> children;
+    state->getChildren(&children, level, pool);
+    std::sort(children.begin(), children.end(), better);
+    for (unsigned int i = 0; i < children.size(); i++) {
+        State* goal = search(children[i], bound, next);
+        if (goal != NULL) { // the path back up has to stay in the pool
+            return goal;
+        }
+    }
+    for (unsigned int i = 0; i < children.size(); i++) {
+        pool.release(children[i]);
+    }
+    return NULL;
+}
+
+/**
+ * Returns whether or not a position was already reached this iteration at no more cost,
+ * remembering it otherwise
+ *@param state the state
+ *@return true if the state needn't be searched again
+ */
+bool IdaSearch::isKnown(State* state) {
+    uint64_t hash = state->getHash();
+    uint64_t check = checkOf(state);
+    Entry* bucket = &table[hash%buckets*BUCKET];
+    Entry* victim = NULL;
+    for (int i = 0; i < BUCKET; i++) {
+        Entry* entry = &bucket[i];
+        if (entry->hash == hash && entry->check == check && entry->iteration == iteration) {
+            if (entry->g <= state->getG()) { // searched from here with at least as much of the bound left
+                return true;
+            }
+            entry->g = state->getG();
+            return false;
+        }
+        // stale entries go first, then the deepest, shallow ones cut off more of the search
+        if (victim == NULL || (victim->iteration == iteration &&
+                (entry->iteration != iteration || entry->g > victim->g))) {
+            victim = entry;
+        }
+    }
+    victim->hash = hash;
+    victim->check = check;
+    victim->g = state->getG();
+    victim->iteration = iteration;
+    return false;
+}
+
+/**
+ * Returns a hash of a state's position independent of its zobrist hash, to check table hits with
+ *@param state the state
+ *@return hash
+ */
+uint64_t IdaSearch::checkOf(State* state) {
+    // FNV-1a over the sorted cells and the robot's region
+    uint64_t check = 0xcbf29ce484222325ULL;
+    for (int i = 0; i < state->getBlockCount(); i++) {
+        check = (check^state->getBlock(i))*0x100000001b3ULL;
+    }
+    return (check^state->getRegion())*0x100000001b3ULL;
+}
+
+/**
+ * Orders children cheapest f first, then closest to the goals
+ *@param a a child
+ *@param b another child
+ *@return true if a goes first
+ */
+bool IdaSearch::better(State* a, State* b) {
+    if (a->getF() != b->getF()) {
+        return a->getF() < b->getF();
+    }
+    return a->getH() < b->getH();
+}
@@ -0,0 +1,43 @@
+#include "inbox.h"
+#include <cstddef>
+
+/**
+ * Inits an empty inbox
+ */
+Inbox::Inbox() {
+    head = NULL;
+}
+
+/**
+ * Frees any batches never received
+ */
+Inbox::~Inbox() {
+    Batch* batch = receive();
+    while (batch != NULL) {
+        Batch* next = batch->next;
+        delete batch;
+        batch = next;
+    }
+}
+
+/**
+ * Sends a batch, the inbox owns it from now on
+ *@param batch the batch
+ */
+void Inbox::send(Batch* batch) {
+    batch->next = __atomic_load_n(&head, __ATOMIC_RELAXED);
+    // on failure next is reloaded with the current head
+    while (!__atomic_compare_exchange_n(&head, &batch->next, batch, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+}
+
+/**
+ * Takes every batch sent so far, the caller owns them from now on
+ *@return the batches linked through next, NULL if there are none
+ */
+Inbox::Batch* Inbox::receive() {
+    if (__atomic_load_n(&head, __ATOMIC_RELAXED) == NULL) { // cheap check, no write when empty
+        return NULL;
+    }
+    return __atomic_exchange_n(&head, (Batch *)NULL, __ATOMIC_ACQUIRE);
+}
@@ -4,6 +4,7 @@
 #include <cstdio>
 #include <string>
 #include <cmath>
+#include <deque>
 
 /**
  * Inits a new level
@@ -11,12 +12,41 @@
 Level::Level() {
     width = 0;
     height = 0;
+    floorCount = 0;
+    reversed = false;
+    entrance = -1;
+    entry = -1;
+    costModel = COST_SWITCHES;
+    walkBlocks = 0;
+    walkStart = -1;
     robot = NULL;
-    start = NULL;
 
     states = 0;
 }
 
+/**
+ * Copies a loaded level, with scratch space of its own so both can build states at once
+ *@param other the level to copy
+ */
+Level::Level(const Level& other):
+        width(other.width), height(other.height), walls(other.walls),
+        blockHashes(other.blockHashes), robotHashes(other.robotHashes), goalAt(other.goalAt), dead(other.dead),
+        tunnels(other.tunnels), room(other.room), entrance(other.entrance), entry(other.entry),
+        packing(other.packing), packingCells(other.packingCells), packingDirections(other.packingDirections),
+        packingWalks(other.packingWalks),
+        neighbours(other.neighbours), floorIndex(other.floorIndex), floorCount(other.floorCount), reversed(other.reversed),
+        pushDistances(other.pushDistances), workspace(other.workspace), corral(other.corral),
+        patterns(other.patterns), matching(other.matching), costModel(other.costModel), walkBlocks(0), walkStart(-1),
+        states(0) {
+    robot = other.robot != NULL ? new Robot(*other.robot) : NULL;
+    for (unsigned int i = 0; i < other.goals.size(); i++) {
+        goals.push_back(new Goal(*other.goals[i]));
+    }
+    for (unsigned int i = 0; i < other.blocks.size(); i++) {
+        blocks.push_back(new Block(*other.blocks[i]));
+    }
+}
+
 /**
  * Clears memory used by the level
  */
@@ -34,11 +64,6 @@ Level::~Level() {
         delete blocks[i];
     }
     blocks.clear();
-
-    if (start != NULL) {
-        delete start;
-        start = NULL;
-    }
 }
 
 /**
@@ -49,76 +74,153 @@ Level::~Level() {
 bool Level::load(char* file) {
     FILE* f = fopen(file, "r");
     if (f != NULL) {
-        int w = 0;
         std::string mapstr = "";
-        height = 1;
-        while (!feof(f)) {
-            char c = fgetc(f);
-            mapstr += c;
-            if (c == '\n') {
-                if (w > width) {
-                    width = w;
-                }
-                height++;
-                w = 0;
-            }
-            w++;
+        int c;
+        while ((c = fgetc(f)) != EOF) {
+            mapstr += (char)c;
         }
         fclose(f);
+        return parse(mapstr);
+    }
+    printf("File %s not found\n", file);
+    return false;
+}
 
-        walls = "";
-        int x = 0;
-        int y = 0;
-        for (unsigned int i = 0; i < mapstr.size(); i++) {
-            if (mapstr[i] != '\n') {
-                // place walls
-                walls += mapstr[i] == WALL ? WALL : EMPTY;
-
-                // place additional objects
-                switch (mapstr[i]) {
-                    case ROBOT:
-                        robot = new Robot(x, y);
-                        break;
-                    case ROBOT_ON_GOAL:
-                        robot = new Robot(x, y);
-                        goals.push_back(new Goal(x, y));
-                        break;
-                    case BLOCK:
-                        blocks.push_back(new Block(x, y));
-                        break;
-                    case BLOCK_ON_GOAL:
-                        blocks.push_back(new Block(x, y));
-                        goals.push_back(new Goal(x, y));
-                        break;
-                    case GOAL:
-                        goals.push_back(new Goal(x, y));
-                        break;
-                }
+/**
+ * Loads a level from its map, one row per line
+ *@param mapstr the map
+ *@return true on success, false on failure
+ */
+bool Level::parse(std::string& mapstr) {
+    width = 0;
+    height = 0;
+    int w = 0;
+    for (unsigned int i = 0; i < mapstr.size(); i++) {
+        if (mapstr[i] == '\n') {
+            height++;
+            w = 0;
+        } else if (mapstr[i] != '\r') {
+            w++;
+            if (w > width) {
+                width = w;
+            }
+        }
+    }
+    if (w > 0) { // last row without a line break
+        height++;
+    }
+    if ((long long)width*height > MAX_CELLS) {
+        printf("Error, the level has %lld cells, at most %d are supported\n", (long long)width*height, MAX_CELLS);
+        return false;
+    }
+
+    walls = "";
+    int x = 0;
+    int y = 0;
+    for (unsigned int i = 0; i < mapstr.size(); i++) {
+        if (mapstr[i] == '\r') {
+            continue;
+        } else if (mapstr[i] != '\n') {
+            // place walls
+            walls += mapstr[i] == WALL ? WALL : EMPTY;
+
+            // place additional objects
+            switch (mapstr[i]) {
+                case ROBOT:
+                    robot = new Robot(x, y);
+                    break;
+                case ROBOT_ON_GOAL:
+                    robot = new Robot(x, y);
+                    goals.push_back(new Goal(x, y));
+                    break;
+                case BLOCK:
+                    blocks.push_back(new Block(x, y));
+                    break;
+                case BLOCK_ON_GOAL:
+                    blocks.push_back(new Block(x, y));
+                    goals.push_back(new Goal(x, y));
+                    break;
+                case GOAL:
+                    goals.push_back(new Goal(x, y));
+                    break;
+            }
 
+            x++;
+        } else {
+            while (x < width) {
+                walls += EMPTY;
                 x++;
-            } else {
-                while (x < width) {
-                    walls += EMPTY;
-                    x++;
-                }
-                y++;
-                x = 0;
             }
+            y++;
+            x = 0;
         }
+    }
+    walls.resize(width*height, EMPTY); // pad the last row
+    if (robot == NULL) {
+        printf("Error, the level has no robot\n");
+        return false;
+    }
 
-        if (blocks.size() < goals.size()) {
-            printf("Error, not enough blocks to cover all goals\n");
-            return false;
-        }
+    // fixed seed, the hashes only need to be random-looking, not different between runs
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    blockHashes.resize(walls.size());
+    robotHashes.resize(walls.size());
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        blockHashes[i] = nextHash(seed);
+        robotHashes[i] = nextHash(seed);
+    }
 
-        start = new State(*this);
+    indexFloor();
 
-        //printf("%s\n", start->get().c_str());
+    goalAt.assign(walls.size(), -1);
+    for (unsigned int i = 0; i < goals.size(); i++) {
+        goalAt[goals[i]->getX()+goals[i]->getY()*width] = i;
+    }
+    corral.resize(walls.size());
 
-        return true;
+    if (blocks.size() < goals.size()) {
+        printf("Error, not enough blocks to cover all goals\n");
+        return false;
     }
-    printf("File %s not found\n", file);
-    return false;
+
+    findPushDistances();
+    findDeadSquares();
+    findTunnels();
+    workspace.resize(width, height, walls, dead);
+
+    return true;
+}
+
+/**
+ * Turns this copy of a level around, for a search pulling blocks back from the goals
+ * The cells the blocks start on become the goals and the goals hold the blocks,
+ * so push distances become the pulls back to where the blocks started
+ */
+void Level::reverse() {
+    std::vector<Goal *> starts;
+    std::vector<Block *> ends;
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        starts.push_back(new Goal(blocks[i]->getX(), blocks[i]->getY()));
+        delete blocks[i];
+    }
+    for (unsigned int i = 0; i < goals.size(); i++) {
+        ends.push_back(new Block(goals[i]->getX(), goals[i]->getY()));
+        delete goals[i];
+    }
+    goals.swap(starts);
+    blocks.swap(ends);
+
+    goalAt.assign(walls.size(), -1);
+    for (unsigned int i = 0; i < goals.size(); i++) {
+        goalAt[goals[i]->getX()+goals[i]->getY()*width] = i;
+    }
+    reversed = !reversed;
+    findPushDistances();
+    findDeadSquares();
+    findTunnels();
+    entrance = -1; // packing macros are pushes
+    packing.clear();
+    workspace.resize(width, height, walls, dead);
 }
 
 /**
@@ -162,11 +264,12 @@ std::vector<Block *>& Level::getBlocks() {
 }
 
 /**
- * Returns the starting state
- *@return start
+ * Builds the starting state
+ *@param pool the pool the search keeps its states in
+ *@return the start state
  */
-State* Level::getStart() {
-    return start;
+State* Level::getStart(NodePool& pool) {
+    return State::create(pool, *this);
 }
 
 /**
@@ -177,6 +280,359 @@ std::string& Level::getWallMap() {
     return walls;
 }
 
+/**
+ * Returns the zobrist hash of a block sitting on a cell
+ *@param index the cell
+ *@return the hash
+ */
+uint64_t Level::getBlockHash(int index) {
+    return blockHashes[index];
+}
+
+/**
+ * Returns the zobrist hash of the robot region with this lowest cell
+ *@param index the lowest cell the robot can reach
+ *@return the hash
+ */
+uint64_t Level::getRobotHash(int index) {
+    return robotHashes[index];
+}
+
+/**
+ * Returns the goal on a cell
+ *@param index the cell
+ *@return the goal, -1 if the cell isn't a goal
+ */
+int Level::getGoalAt(int index) {
+    return goalAt[index];
+}
+
+/**
+ * Returns the block currently on a cell
+ *@param index the cell
+ *@return the block, -1 if there is none
+ */
+int Level::getBlockAt(int index) {
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        if (blocks[i]->getX()+blocks[i]->getY()*width == index) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Returns the corral finder states use while they're being built
+ *@return corral
+ */
+Corral& Level::getCorral() {
+    return corral;
+}
+
+/**
+ * Returns the deadlock patterns known so far
+ *@return patterns
+ */
+DeadlockPatterns& Level::getPatterns() {
+    return patterns;
+}
+
+/**
+ * Returns the block to goal matcher states use to evaluate themselves
+ *@return matching
+ */
+Matching& Level::getMatching() {
+    return matching;
+}
+
+/**
+ * Returns whether or not there are more blocks than goals
+ * Spare blocks can stay anywhere, so deadlocks only count when there are none
+ *@return true if some blocks never need to reach a goal
+ */
+bool Level::hasSpareBlocks() {
+    return blocks.size() != goals.size();
+}
+
+/**
+ * Returns whether or not a block on this cell can never reach a goal
+ *@param index the cell
+ *@return true if pushing a block here loses the level
+ */
+bool Level::isDead(int index) {
+    return dead[index];
+}
+
+/**
+ * Returns whether or not a block pushed onto a cell is in a tunnel, where the robot
+ * can only push it on or walk back out, and the cell it goes to next is still in the tunnel
+ *@param index the cell
+ *@param direction the direction the block was pushed
+ *@return true if the block should be pushed on in the same push
+ */
+bool Level::isTunnel(int index, int direction) {
+    return tunnels[index*4+direction];
+}
+
+/**
+ * Looks for a room holding every goal with a single entrance, and an order to fill its goals in,
+ * found backwards from the full room by taking out blocks that can still be pushed back out
+ * Blocks pushed onto the entrance then go straight to the next goal in that order
+ */
+void Level::findGoalRoom() {
+    room.assign(walls.size(), 0);
+    entrance = -1;
+    packing.clear();
+    packingCells.clear();
+    packingDirections.clear();
+    packingWalks.clear();
+    if (hasSpareBlocks() || reversed || goals.empty()) {
+        return;
+    }
+
+    // the smallest area cut off by a single cell that has every goal and nothing else
+    int start = robot->getX()+robot->getY()*width;
+    int first = goals[0]->getX()+goals[0]->getY()*width;
+    std::vector<char> area;
+    std::vector<int> cells;
+    unsigned int smallest = walls.size();
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        if (floorIndex[i] == -1 || goalAt[i] != -1) {
+            continue;
+        }
+        area.assign(walls.size(), 0);
+        area[i] = 1;
+        area[first] = 1;
+        cells.assign(1, first);
+        for (unsigned int j = 0; j < cells.size(); j++) {
+            for (int dir = 0; dir < 4; dir++) {
+                int next = neighbour(cells[j], dir);
+                if (next != -1 && !area[next]) {
+                    area[next] = 1;
+                    cells.push_back(next);
+                }
+            }
+        }
+        area[i] = 0;
+        bool found = cells.size() < smallest && (start == (int)i || !area[start]);
+        for (unsigned int j = 0; j < blocks.size() && found; j++) {
+            found = !area[blocks[j]->getX()+blocks[j]->getY()*width];
+        }
+        for (unsigned int j = 0; j < goals.size() && found; j++) {
+            found = area[goals[j]->getX()+goals[j]->getY()*width];
+        }
+        int into = -1;
+        for (int dir = 0; dir < 4 && found; dir++) {
+            int next = neighbour(i, dir);
+            if (next != -1 && area[next]) {
+                found = into == -1; // a single way in, or the order could be broken from the side
+                into = dir;
+            }
+        }
+        // blocks come in pushed straight through it
+        if (found && into != -1 && neighbour(i, into^1) != -1) {
+            room.swap(area);
+            entrance = i;
+            entry = into;
+            smallest = cells.size();
+        }
+    }
+    if (entrance == -1) {
+        return;
+    }
+
+    // take blocks out of the full room one at a time, the one closest to the entrance first,
+    // whichever can be pushed in last with the rest already there and still let the robot out
+    std::vector<char> blocked(walls.size(), 0);
+    std::vector<int> left;
+    for (unsigned int i = 0; i < goals.size(); i++) {
+        left.push_back(goals[i]->getX()+goals[i]->getY()*width);
+        blocked[left[i]] = 1;
+    }
+    std::vector<int> pathCells;
+    std::vector<int> pathDirections;
+    int pathWalk;
+    while (!left.empty()) {
+        int chosen = -1;
+        std::vector<int> bestCells;
+        std::vector<int> bestDirections;
+        int bestWalk = 0;
+        for (unsigned int i = 0; i < left.size(); i++) {
+            blocked[left[i]] = 0;
+            bool found = findPackingPath(left[i], blocked, &pathCells, &pathDirections, &pathWalk);
+            blocked[left[i]] = 1;
+            // the robot has to get back out for the next block, except after the last one
+            if (found && (left.size() == goals.size() || canLeaveRoom(pathCells.back(), blocked)) &&
+                    (chosen == -1 || pathCells.size() < bestCells.size())) {
+                chosen = i;
+                bestCells.swap(pathCells);
+                bestDirections.swap(pathDirections);
+                bestWalk = pathWalk;
+            }
+        }
+        if (chosen == -1) { // no order fills the room
+            entrance = -1;
+            packing.clear();
+            packingCells.clear();
+            packingDirections.clear();
+            packingWalks.clear();
+            return;
+        }
+        blocked[left[chosen]] = 0;
+        packing.insert(packing.begin(), left[chosen]);
+        packingCells.insert(packingCells.begin(), bestCells);
+        packingDirections.insert(packingDirections.begin(), bestDirections);
+        packingWalks.insert(packingWalks.begin(), bestWalk);
+        left.erase(left.begin()+chosen);
+    }
+
+    // a block stops on the entrance, that's where the packing order takes over
+    for (int dir = 0; dir < 4; dir++) {
+        tunnels[entrance*4+dir] = 0;
+    }
+}
+
+/**
+ * Returns the cell blocks get into the goal room from
+ *@return the entrance, -1 if there's no goal room
+ */
+int Level::getRoomEntrance() {
+    return entrance;
+}
+
+/**
+ * Returns the direction a block is pushed from the entrance into the goal room
+ *@return the direction
+ */
+int Level::getRoomEntry() {
+    return entry;
+}
+
+/**
+ * Returns how far the goal room is filled, if it holds just the first goals of the packing order
+ *@param cells the cells holding blocks
+ *@param count how many there are
+ *@return how many goals are filled, -1 if any other block is in the room
+ */
+int Level::getPackedCount(unsigned short* cells, int count) {
+    int filled = 0;
+    int last = -1;
+    for (int i = 0; i < count; i++) {
+        if (room[cells[i]]) {
+            int step = getPackingStep(cells[i]);
+            if (step == -1) {
+                return -1;
+            }
+            filled++;
+            last = step > last ? step : last;
+        }
+    }
+    // every block is on a different goal, so they're the first ones if none is further along
+    return last < filled ? filled : -1;
+}
+
+/**
+ * Returns how many goals the packing order has
+ *@return the goals in the goal room
+ */
+int Level::getPackingSize() {
+    return packing.size();
+}
+
+/**
+ * Returns the goal filled at a step of the packing order
+ *@param step the step
+ *@return the goal's cell
+ */
+int Level::getPackingGoal(int step) {
+    return packing[step];
+}
+
+/**
+ * Returns the step of the packing order a goal is filled at
+ *@param index the goal's cell
+ *@return the step, -1 if the goal isn't in the goal room
+ */
+int Level::getPackingStep(int index) {
+    for (unsigned int i = 0; i < packing.size(); i++) {
+        if (packing[i] == index) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Returns the cells a block is pushed from, from the entrance onto a step's goal
+ *@param step the step
+ *@return a cell per push
+ */
+std::vector<int>& Level::getPackingCells(int step) {
+    return packingCells[step];
+}
+
+/**
+ * Returns the directions a block is pushed, from the entrance onto a step's goal
+ *@param step the step
+ *@return a direction per push
+ */
+std::vector<int>& Level::getPackingDirections(int step) {
+    return packingDirections[step];
+}
+
+/**
+ * Returns how many steps the robot walks between the pushes that fill a step's goal
+ *@param step the step
+ *@return the moves that aren't pushes
+ */
+int Level::getPackingWalk(int step) {
+    return packingWalks[step];
+}
+
+/**
+ * Returns the fewest pushes that get a lone block from a cell onto each goal, in goal order
+ *@param index the cell
+ *@return one distance per goal, NO_DISTANCE if the block can't get there
+ */
+unsigned short* Level::getPushDistances(int index) {
+    return &pushDistances[floorIndex[index]*goals.size()];
+}
+
+/**
+ * Returns the cell next to another one
+ *@param index the cell
+ *@param direction which neighbour
+ *@return the neighbouring cell, -1 if it's a wall or off the map
+ */
+int Level::neighbour(int index, int direction) {
+    return neighbours[index*4+direction];
+}
+
+/**
+ * Returns how many cells aren't walls
+ *@return the number of floor cells
+ */
+int Level::getFloorCount() {
+    return floorCount;
+}
+
+/**
+ * Returns the dense number of a floor cell, floor cells are numbered 0 to getFloorCount()-1
+ *@param index the cell
+ *@return the floor number, -1 for walls
+ */
+int Level::getFloorIndex(int index) {
+    return floorIndex[index];
+}
+
+/**
+ * Returns the scratch grids states use while they're being built
+ *@return workspace
+ */
+Workspace& Level::getWorkspace() {
+    return workspace;
+}
+
 /**
  * Determines the path the robot would need to take to push the block
  *@param block which block to push
@@ -290,138 +746,391 @@ std::string& Level::getWallMap() {
  *@param path (out) the path the robot must take to make the push (in reverse)
  */
 void Level::pushBlock(int block, int direction, std::vector<int>* path) {
-    int bx = blocks[block]->getX();
-    int by = blocks[block]->getY();
-    switch (direction) {
-        case UP:
-            by++;
-            break;
-        case DOWN:
-            by--;
-            break;
-        case LEFT:
-            bx++;
-            break;
-        case RIGHT:
-            bx--;
-            break;
+    int from = blocks[block]->getX()+blocks[block]->getY()*width;
+    int goal = neighbour(from, direction^1); // UP^1 == DOWN, LEFT^1 == RIGHT
+    int start = robot->getX()+robot->getY()*width;
+
+    // breadth first around the blocks, every step costs the same so the first time the robot
+    // gets to the cell behind the block is the shortest walk. Each cell remembers the way it was entered
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        workspace.placeBlock(blocks[i]->getX()+blocks[i]->getY()*width, i);
+    }
+    workspace.resetVisited();
+    workspace.visit(start);
+    robotCells.assign(1, start);
+    robotMoves.resize(walls.size());
+    for (unsigned int i = 0; i < robotCells.size() && !workspace.isVisited(goal); i++) {
+        int current = robotCells[i];
+        states++;
+        for (int dir = 0; dir < 4; dir++) {
+            int next = neighbour(current, dir);
+            if (next != -1 && !workspace.isVisited(next) && workspace.getBlock(next) == -1) {
+                workspace.visit(next);
+                robotMoves[next] = dir;
+                robotCells.push_back(next);
+            }
+        }
+    }
+    for (unsigned int i = 0; i < blocks.size(); i++) {
+        workspace.removeBlock(blocks[i]->getX()+blocks[i]->getY()*width);
     }
 
-    //printf("pathTo(%dx%d => %dx%d)\n", x, y, bx, by);
+    // the path goes back from the cell behind the block, the last step first
+    for (int current = goal; current != start; current = neighbour(current, robotMoves[current]^1)) {
+        path->push_back(robotMoves[current]);
+    }
 
-    int goal = bx+by*width;
-    int start = robot->getX()+robot->getY()*width;
+    robot->placeAt(blocks[block]->getX(), blocks[block]->getY());
+    blocks[block]->push(direction);
+}
 
-    std::map<int, int> closedset;
-    std::map<int, int> openset;
-    std::map<int, int> g_costs;
-    openset[start] = evaluate(start, bx, by);
-    g_costs[start] = 0;
-    std::map<int, int> came_from;
+/**
+ * Returns how many robot states were opened
+ *@return states
+ */
+int Level::getRobotStatesExpanded() {
+    return states;
+}
 
-    //A* states
-    while (!openset.empty()) {
-        int current = best(openset);
+/**
+ * Sets what a solution's cost counts, before any state is built
+ *@param model COST_SWITCHES, COST_PUSHES, COST_PUSHES_MOVES or COST_MOVES_PUSHES
+ */
+void Level::setCostModel(int model) {
+    costModel = model;
+    walkStart = -1;
+}
 
-        closedset[current] = openset[current];
-        openset.erase(current);
+/**
+ * Returns what a solution's cost counts
+ *@return the cost model
+ */
+int Level::getCostModel() {
+    return costModel;
+}
 
-        states++;
+/**
+ * Returns whether or not the cost counts the robot's moves, so states need its exact cell
+ *@return true for COST_PUSHES_MOVES and COST_MOVES_PUSHES
+ */
+bool Level::countsMoves() {
+    return costModel == COST_PUSHES_MOVES || costModel == COST_MOVES_PUSHES;
+}
 
-        if (current == goal) { // goal
-            // reconstruct path
-            while (came_from.count(current)) {
-                int dir = UP;
-                int difference = came_from[current]-current;
-                if (difference == -1) {
-                    dir = RIGHT;
-                } else if (difference == 1) {
-                    dir = LEFT;
-                } else if (difference == -width) {
-                    dir = DOWN;
-                }
-                path->push_back(dir);
-                //printf("%d ", dir);
-                //blocks[block]->getPath(direction).push_back(dir);
-                current = came_from[current];
+/**
+ * Returns what some pushes and moves cost, the moves include the pushes
+ * Without moves in the cost it's just the pushes, block switches are up to the state
+ *@param pushes the pushes
+ *@param moves the moves
+ *@return the cost
+ */
+int Level::getCost(int pushes, int moves) {
+    // two counts are ranked one after the other by weighting the first, ties are left to the second
+    if (costModel == COST_PUSHES_MOVES) {
+        return pushes*LEX_SCALE+moves;
+    } else if (costModel == COST_MOVES_PUSHES) {
+        return moves*LEX_SCALE+pushes;
+    }
+    return pushes;
+}
+
+/**
+ * Returns whether or not getCost ranks some pushes and moves exactly
+ * Past LEX_SCALE the second count carries into the first, and past DEAD_END/LEX_SCALE the first runs into DEAD_END
+ *@param pushes the pushes
+ *@param moves the moves
+ *@return true if the cost doesn't count both, or both are within the limits
+ */
+bool Level::isCostExact(int pushes, int moves) {
+    if (!countsMoves()) {
+        return true;
+    }
+    int first = costModel == COST_MOVES_PUSHES ? moves : pushes;
+    int second = costModel == COST_MOVES_PUSHES ? pushes : moves;
+    return second < LEX_SCALE && first < DEAD_END/LEX_SCALE-1;
+}
+
+/**
+ * Returns the heuristic for a lower bound on the pushes left, every push being a move too
+ *@param pushes the pushes left at least
+ *@return h in the cost model
+ */
+int Level::getHeuristic(int pushes) {
+    return getCost(pushes, pushes);
+}
+
+/**
+ * Returns the pushes a heuristic was worked out from
+ *@param h a heuristic from getHeuristic
+ *@return the pushes left at least
+ */
+int Level::getHeuristicPushes(int h) {
+    return countsMoves() ? h/(LEX_SCALE+1) : h;
+}
+
+/**
+ * Returns how many steps the robot walks from its cell in a state to another cell, around the state's blocks
+ * The walks are searched once per state, and kept until a different state asks
+ *@param state the state, its region is the robot's cell when moves are counted
+ *@param index the cell to walk to
+ *@return the steps, -1 if the robot can't get there
+ */
+int Level::getWalk(State* state, int index) {
+    if (state->getRegion() == walkStart && state->getBlockHash() == walkBlocks) {
+        return walks[index];
+    }
+    walkStart = state->getRegion();
+    walkBlocks = state->getBlockHash();
+    for (int i = 0; i < state->getBlockCount(); i++) {
+        workspace.placeBlock(state->getBlock(i), i);
+    }
+    walks.assign(walls.size(), -1);
+    walks[walkStart] = 0;
+    robotCells.assign(1, walkStart);
+    for (unsigned int i = 0; i < robotCells.size(); i++) {
+        for (int dir = 0; dir < 4; dir++) {
+            int next = neighbour(robotCells[i], dir);
+            if (next != -1 && walks[next] == -1 && workspace.getBlock(next) == -1) {
+                walks[next] = walks[robotCells[i]]+1;
+                robotCells.push_back(next);
             }
-            break;
         }
+    }
+    for (int i = 0; i < state->getBlockCount(); i++) {
+        workspace.removeBlock(state->getBlock(i));
+    }
+    return walks[index];
+}
 
-        for (int i = 0; i < 4; i++) {
-            int child = current;
-            switch (i) {
-                case UP:
-                    child -= width;
-                    break;
-                case DOWN:
-                    child += width;
-                    break;
-                case LEFT:
-                    child--;
-                    break;
-                case RIGHT:
-                    child++;
-                    break;
+/**
+ * Numbers the floor cells and builds the neighbour table, so moving around the map
+ * is a table lookup instead of index arithmetic and wall checks
+ */
+void Level::indexFloor() {
+    floorIndex.assign(walls.size(), -1);
+    floorCount = 0;
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        if (walls[i] != WALL) {
+            floorIndex[i] = floorCount++;
+        }
+    }
+
+    neighbours.assign(walls.size()*4, -1);
+    for (int i = 0; i < (int)walls.size(); i++) {
+        int x = i%width;
+        int next[4] = {i-width, i+width, x > 0 ? i-1 : -1, x < width-1 ? i+1 : -1}; // UP, DOWN, LEFT, RIGHT
+        for (int dir = 0; dir < 4; dir++) {
+            if (next[dir] >= 0 && next[dir] < (int)walls.size() && walls[next[dir]] != WALL) {
+                neighbours[i*4+dir] = next[dir];
             }
+        }
+    }
+}
 
-            bool invalidSquare = false;
-            for (unsigned int j = 0; j < blocks.size(); j++) {
-                if (child == blocks[j]->getX()+blocks[j]->getY()*width) {
-                    invalidSquare = true;
-                    break;
+/**
+ * Works out the push distance from every cell to every goal
+ * Pulling a block away from a goal, breadth first, reaches each cell with the fewest pulls,
+ * which is the fewest pushes back, ignoring where the robot has to walk.
+ * A reversed level pushes away from its goals instead, giving the fewest pulls back
+ */
+void Level::findPushDistances() {
+    unsigned int stride = goals.size();
+    pushDistances.assign(floorCount*stride, NO_DISTANCE);
+    std::vector<int> queue;
+    for (unsigned int i = 0; i < stride; i++) {
+        queue.clear();
+        queue.push_back(goals[i]->getX()+goals[i]->getY()*width);
+        pushDistances[floorIndex[queue[0]]*stride+i] = 0;
+        // pulling a block one cell needs that cell and the one past it free for the robot,
+        // pushing it needs that cell and the one behind the block
+        for (unsigned int j = 0; j < queue.size(); j++) {
+            int distance = pushDistances[floorIndex[queue[j]]*stride+i]+1;
+            for (int dir = 0; dir < 4; dir++) {
+                int to = neighbour(queue[j], dir);
+                if (to == -1 || pushDistances[floorIndex[to]*stride+i] != NO_DISTANCE) {
+                    continue;
                 }
+                int robot = reversed ? neighbour(queue[j], dir^1) : neighbour(to, dir);
+                if (robot == -1) {
+                    continue;
+                }
+                pushDistances[floorIndex[to]*stride+i] = distance;
+                queue.push_back(to);
             }
+        }
+    }
+}
 
-            if (invalidSquare || walls[child] != EMPTY || closedset.count(child)) {
+/**
+ * Marks the cells a block can never be pushed from onto a goal,
+ * the ones no goal has a push distance from
+ */
+void Level::findDeadSquares() {
+    dead.assign(walls.size(), 0);
+    if (hasSpareBlocks()) { // spare blocks can be parked anywhere, nothing is dead
+        return;
+    }
+    unsigned int stride = goals.size();
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        if (floorIndex[i] == -1) {
+            continue; // nothing gets pushed into a wall anyway
+        }
+        dead[i] = 1;
+        for (unsigned int j = 0; j < stride && dead[i]; j++) {
+            dead[i] = pushDistances[floorIndex[i]*stride+j] == NO_DISTANCE;
+        }
+    }
+}
+
+/**
+ * Marks the cells a block is pushed on through, for each direction it can come in from:
+ * cells off goals in one wide corridors, with the robot's cell behind them and the next cell
+ * in the corridor too
+ */
+void Level::findTunnels() {
+    tunnels.assign(walls.size()*4, 0);
+    if (hasSpareBlocks() || reversed) { // a spare block may be parked in a tunnel, and pulls aren't macros
+        return;
+    }
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        if (floorIndex[i] == -1 || goalAt[i] != -1) {
+            continue;
+        }
+        for (int direction = 0; direction < 4; direction++) {
+            int robot = neighbour(i, direction^1);
+            int next = neighbour(i, direction);
+            if (robot == -1 || next == -1 || dead[next]) {
                 continue;
             }
-            int tentative_g = g_costs[current]+1;
-
-            if (!openset.count(child) || tentative_g < g_costs[child]) {
-                came_from[child] = current;
-                g_costs[child] = tentative_g;
-                openset[child] = g_costs[child]+evaluate(child, bx, by);
+            // walls on both sides of the robot, the block and where it goes next
+            int side = direction < LEFT ? LEFT : UP;
+            int cells[3] = {robot, (int)i, next};
+            bool walled = true;
+            for (int j = 0; j < 3 && walled; j++) {
+                walled = neighbour(cells[j], side) == -1 && neighbour(cells[j], side^1) == -1;
             }
+            tunnels[i*4+direction] = walled;
         }
     }
-
-    robot->placeAt(blocks[block]->getX(), blocks[block]->getY());
-    blocks[block]->push(direction);
 }
 
 /**
- * Returns how many robot states were opened
- *@return states
+ * Finds the fewest pushes that get a block from the goal room's entrance onto a goal,
+ * with the robot starting behind it and only the cells of the room to use
+ *@param goal the goal's cell
+ *@param blocked the cells holding blocks already
+ *@param cells (out) the cell the block is pushed from, per push
+ *@param directions (out) the direction it's pushed, per push
+ *@param walk (out) the steps the robot walks between the pushes
+ *@return false if the block can't get there
  */
-int Level::getRobotStatesExpanded() {
-    return states;
+bool Level::findPackingPath(int goal, std::vector<char>& blocked, std::vector<int>* cells, std::vector<int>* directions, int* walk) {
+    // number the room, the entrance and the cell behind it, a state is the block's and the robot's number
+    std::vector<int> area;
+    std::vector<int> number(walls.size(), -1);
+    for (unsigned int i = 0; i < walls.size(); i++) {
+        if (room[i] || (int)i == entrance || (int)i == neighbour(entrance, entry^1)) {
+            number[i] = area.size();
+            area.push_back(i);
+        }
+    }
+    int size = area.size();
+    std::vector<int> pushes(size*size, -1);
+    std::vector<int> previous(size*size, -1);
+    std::deque<int> queue;
+    int first = number[entrance]*size+number[neighbour(entrance, entry^1)];
+    pushes[first] = 0;
+    queue.push_back(first);
+
+    // walking is free and pushing costs 1, so walks go in the front of the queue and pushes at the back
+    while (!queue.empty()) {
+        int state = queue.front();
+        queue.pop_front();
+        int block = area[state/size];
+        int robot = area[state%size];
+        if (block == goal) {
+            cells->clear();
+            directions->clear();
+            *walk = 0;
+            for (int at = state; previous[at] != -1; at = previous[at]) {
+                int from = area[previous[at]/size];
+                if (from == area[at/size]) {
+                    (*walk)++;
+                } else {
+                    for (int dir = 0; dir < 4; dir++) {
+                        if (neighbour(from, dir) == area[at/size]) {
+                            cells->insert(cells->begin(), from);
+                            directions->insert(directions->begin(), dir);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+        for (int dir = 0; dir < 4; dir++) {
+            int next = neighbour(robot, dir);
+            if (next == -1 || number[next] == -1 || blocked[next]) {
+                continue;
+            }
+            if (next != block) {
+                int walked = state/size*size+number[next];
+                if (pushes[walked] == -1 || pushes[state] < pushes[walked]) {
+                    pushes[walked] = pushes[state];
+                    previous[walked] = state;
+                    queue.push_front(walked);
+                }
+                continue;
+            }
+            int to = neighbour(block, dir);
+            if (to == -1 || blocked[to] || !(room[to] || to == entrance)) {
+                continue;
+            }
+            int pushed = number[to]*size+number[block];
+            if (pushes[pushed] == -1 || pushes[state]+1 < pushes[pushed]) {
+                pushes[pushed] = pushes[state]+1;
+                previous[pushed] = state;
+                queue.push_back(pushed);
+            }
+        }
+    }
+    return false;
 }
 
 /**
- * Grabs the best guess from the openset
- *@param openset the open set
- *@return the bets guess of where to go next
+ * Returns whether or not the robot can get from a cell in the goal room back to its entrance
+ *@param index the robot's cell
+ *@param blocked the cells holding blocks
+ *@return true if it can get out
  */
-int Level::best(std::map<int, int>& openset) {
-    int best = -1;
-    int bestF = -1;
-    for (std::map<int, int>::iterator i = openset.begin(); i != openset.end(); i++) {
-        if (best == -1 || i->second < bestF) {
-            bestF = i->second;
-            best = i->first;
+bool Level::canLeaveRoom(int index, std::vector<char>& blocked) {
+    std::vector<char> seen(walls.size(), 0);
+    std::vector<int> cells(1, index);
+    seen[index] = 1;
+    for (unsigned int i = 0; i < cells.size(); i++) {
+        if (cells[i] == entrance) {
+            return true;
+        }
+        for (int dir = 0; dir < 4; dir++) {
+            int next = neighbour(cells[i], dir);
+            if (next != -1 && !seen[next] && !blocked[next] && (room[next] || next == entrance)) {
+                seen[next] = 1;
+                cells.push_back(next);
+            }
         }
     }
-    return best;
+    return false;
 }
 
 /**
- * Evaluates (calculates h) how good this state is
- * heuristic = manhatten distance
- *@param index the location of the robot
- *@param bx destination x
- *@param by destination y
+ * Generates the next zobrist hash (splitmix64)
+ *@param seed (in/out) the generator state
+ *@return a random 64 bit value
  */
-int Level::evaluate(int index, int bx, int by) {
-    return std::abs(index/width-by)+std::abs((index%width)-bx);
+uint64_t Level::nextHash(uint64_t& seed) {
+    seed += 0x9e3779b97f4a7c15ULL;
+    uint64_t z = seed;
+    z = (z^(z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z^(z >> 27))*0x94d049bb133111ebULL;
+    return z^(z >> 31);
 }
+
@@ -0,0 +1,204 @@
+#include "matching.h"
+#include "level.h"
+#include "constants.h"
+#include <climits>
+
+#define NO_PATH (1 << 24) /**< cost of a block that can't reach a goal, more than any real matching */
+
+/**
+ * Inits an empty matcher
+ */
+Matching::Matching() {
+}
+
+/**
+ * Returns the fewest pushes needed to put a different block on every goal
+ *@param level the level, with its push distances
+ *@param blocks the cells holding blocks
+ *@param count how many blocks there are
+ *@param assignment (out) the column each block is matched to, goals first then dummy goals
+ *@return the cost of the best matching, -1 if the goals can't all be covered
+ */
+int Matching::solve(Level& level, unsigned short* blocks, unsigned int count, unsigned short* assignment) {
+    int goals = level.getGoals().size();
+    int rows = count;
+    // square it up: spare blocks match a free dummy goal, and in a corral sub search
+    // the missing blocks match any goal for free
+    int size = rows > goals ? rows : goals;
+    costs.assign(size*size, 0);
+    for (int i = 0; i < rows; i++) {
+        unsigned short* distances = level.getPushDistances(blocks[i]);
+        int* row = &costs[i*size];
+        for (int j = 0; j < goals; j++) {
+            row[j] = distances[j] == NO_DISTANCE ? NO_PATH : distances[j];
+        }
+    }
+
+    rowPotential.assign(size+1, 0);
+    columnPotential.assign(size+1, 0);
+    columnRow.assign(size+1, 0);
+    way.assign(size+1, 0);
+    slack.resize(size+1);
+    used.resize(size+1);
+
+    // add the rows one by one, each time growing a shortest augmenting path to a free column
+    for (int row = 1; row <= size; row++) {
+        columnRow[0] = row;
+        int column = 0;
+        slack.assign(size+1, INT_MAX);
+        used.assign(size+1, 0);
+        do {
+            used[column] = 1;
+            int from = columnRow[column];
+            int delta = INT_MAX;
+            int next = 0;
+            for (int j = 1; j <= size; j++) {
+                if (used[j]) {
+                    continue;
+                }
+                int reduced = costs[(from-1)*size+j-1]-rowPotential[from]-columnPotential[j];
+                if (reduced < slack[j]) {
+                    slack[j] = reduced;
+                    way[j] = column;
+                }
+                if (slack[j] < delta) {
+                    delta = slack[j];
+                    next = j;
+                }
+            }
+            for (int j = 0; j <= size; j++) {
+                if (used[j]) {
+                    rowPotential[columnRow[j]] += delta;
+                    columnPotential[j] -= delta;
+                } else {
+                    slack[j] -= delta;
+                }
+            }
+            column = next;
+        } while (columnRow[column] != 0);
+
+        // flip the path
+        do {
+            int previous = way[column];
+            columnRow[column] = columnRow[previous];
+            column = previous;
+        } while (column != 0);
+    }
+
+    int cost = 0;
+    for (int j = 1; j <= size; j++) {
+        cost += costs[(columnRow[j]-1)*size+j-1];
+        if (columnRow[j] <= rows) {
+            assignment[columnRow[j]-1] = j-1;
+        }
+    }
+    return cost >= NO_PATH ? -1 : cost;
+}
+
+/**
+ * Fixes up the best matching after one block moved, instead of solving it again
+ * Dropping the moved block leaves the rest optimal, so the cheapest alternating path from
+ * the moved block back to its old column gives the new best matching.
+ * Taking a column from a row makes a negative edge, and states don't keep the duals that would
+ * make them non-negative for Dijkstra, so the path is found by FIFO label correcting (Bellman-Ford-Moore).
+ * A pass over the queued rows is O(n^2) for n rows and a row can be queued n times, O(n^3) at worst
+ * like solving again, but in practice a row is rarely queued twice, so it stays close to O(n^2)
+ *@param level the level, with its push distances
+ *@param blocks the cells holding blocks, with the moved one on its new cell
+ *@param count how many blocks there are
+ *@param assignment (in/out) the best matching before the move, fixed up for after it
+ *@param row which block moved
+ *@param cost the cost of the matching before the move, without the moved block's part
+ *@return the cost of the best matching, -1 if the goals can't all be covered
+ */
+int Matching::repair(Level& level, unsigned short* blocks, unsigned int count, unsigned short* assignment, unsigned int row, int cost) {
+    int goals = level.getGoals().size();
+    int rows = count;
+    int size = rows > goals ? rows : goals;
+    int free = assignment[row];
+
+    // missing blocks in a corral sub search take whatever columns are left, they cost nothing anywhere
+    rowOf.assign(size, -1);
+    for (int i = 0; i < rows; i++) {
+        rowOf[assignment[i]] = i;
+    }
+    for (int j = 0, dummy = rows; j < size; j++) {
+        if (rowOf[j] == -1 && j != free) {
+            rowOf[j] = dummy++;
+        }
+    }
+    rowOf[free] = -1;
+
+    // the rest of the matching is optimal, so there are no negative cycles, but the path
+    // can still have negative edges where it takes a column from a row. A row is queued again
+    // each time a cheaper path to it turns up, which is what makes the worst case O(n^3)
+    distance.assign(size, INT_MAX);
+    viaRow.resize(size);
+    viaColumn.resize(size);
+    queued.assign(size, 0);
+    queue.clear();
+    distance[row] = 0;
+    queue.push_back(row);
+    queued[row] = 1;
+    int best = INT_MAX;
+    int bestRow = -1;
+    for (unsigned int q = 0; q < queue.size(); q++) {
+        int from = queue[q];
+        queued[from] = 0;
+        int index = from < rows ? blocks[from] : -1;
+        for (int j = 0; j < size; j++) {
+            int to = rowOf[j];
+            if (to == from) {
+                continue;
+            }
+            int length = distance[from]+(index == -1 ? 0 : getCost(level, index, j));
+            if (to == -1) { // back at the free column
+                if (length < best) {
+                    best = length;
+                    bestRow = from;
+                }
+                continue;
+            }
+            length -= to < rows ? getCost(level, blocks[to], j) : 0;
+            if (length < distance[to]) {
+                distance[to] = length;
+                viaRow[to] = from;
+                viaColumn[to] = j;
+                if (!queued[to]) {
+                    queued[to] = 1;
+                    queue.push_back(to);
+                }
+            }
+        }
+    }
+
+    // walk back along the path, each row taking the column of the one after it
+    int column = free;
+    for (int at = bestRow; ; at = viaRow[at]) {
+        if (at < rows) {
+            assignment[at] = column;
+        }
+        if (at == (int)row) {
+            break;
+        }
+        column = viaColumn[at];
+    }
+
+    cost += best;
+    return cost >= NO_PATH ? -1 : cost;
+}
+
+/**
+ * Returns what matching a block to a goal costs
+ *@param level the level, with its push distances
+ *@param index the block's cell
+ *@param column the goal, or a dummy goal past the real ones
+ *@return the pushes, or a cost bigger than any real matching if the block can't get there
+ */
+int Matching::getCost(Level& level, int index, int column) {
+    if (column >= (int)level.getGoals().size()) {
+        return 0;
+    }
+    int pushes = level.getPushDistances(index)[column];
+    return pushes == NO_DISTANCE ? NO_PATH : pushes;
+}
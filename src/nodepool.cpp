@@ -0,0 +1,68 @@
+#include "nodepool.h"
+#include <cstddef>
+
+#define NODES_PER_SLAB 4096
+
+/**
+ * Inits an empty pool
+ *@param _size how many bytes each node takes
+ */
+NodePool::NodePool(unsigned int _size) {
+    // round up so every node stays pointer aligned
+    size = (_size+sizeof(void *)-1)/sizeof(void *)*sizeof(void *);
+    used = NODES_PER_SLAB;
+    released = NULL;
+}
+
+/**
+ * Frees every slab
+ */
+NodePool::~NodePool() {
+    reset();
+}
+
+/**
+ * Returns memory for one node
+ *@return the node's memory
+ */
+void* NodePool::allocate() {
+    if (released != NULL) {
+        void* node = released;
+        released = *(void **)node;
+        return node;
+    }
+    if (used == NODES_PER_SLAB) {
+        slabs.push_back(new char[size*NODES_PER_SLAB]);
+        used = 0;
+    }
+    return slabs.back()+size*used++;
+}
+
+/**
+ * Gives a node back so its memory can be handed out again
+ *@param node the node to release
+ */
+void NodePool::release(void* node) {
+    *(void **)node = released;
+    released = node;
+}
+
+/**
+ * Frees every node in the pool at once
+ */
+void NodePool::reset() {
+    for (unsigned int i = 0; i < slabs.size(); i++) {
+        delete[] slabs[i];
+    }
+    slabs.clear();
+    used = NODES_PER_SLAB;
+    released = NULL;
+}
+
+/**
+ * Returns how many bytes each node takes
+ *@return size
+ */
+unsigned int NodePool::getSize() {
+    return size;
+}
@@ -0,0 +1,148 @@
+#include "openlist.h"
+#include "state.h"
+
+/**
+ * Inits an empty open list
+ */
+OpenList::OpenList() {
+}
+
+/**
+ * Returns whether or not the open list is empty
+ *@return true if there is nothing left to expand
+ */
+bool OpenList::empty() {
+    return heap.empty();
+}
+
+/**
+ * Returns how many states are waiting to be expanded
+ *@return the heap size
+ */
+unsigned int OpenList::size() {
+    return heap.size();
+}
+
+/**
+ * Adds a state to the open list
+ *@param state the state to add
+ */
+void OpenList::push(State* state) {
+    heap.push_back(state);
+    place(heap.size()-1, state);
+    siftUp(heap.size()-1);
+}
+
+/**
+ * Returns the best state without removing it
+ *@return the state with the lowest f
+ */
+State* OpenList::top() {
+    return heap[0];
+}
+
+/**
+ * Removes and returns the best state
+ *@return the state with the lowest f
+ */
+State* OpenList::pop() {
+    State* top = heap[0];
+    top->openIndex = -1;
+
+    State* last = heap.back();
+    heap.pop_back();
+    if (!heap.empty()) {
+        place(0, last);
+        siftDown(0);
+    }
+    return top;
+}
+
+/**
+ * Swaps a state in the open list for a cheaper copy of itself
+ * The replacement takes over the old state's slot, the old state leaves the list
+ *@param old the state currently in the open list
+ *@param replacement the same state reached with a lower g
+ */
+void OpenList::replace(State* old, State* replacement) {
+    unsigned int index = old->openIndex;
+    old->openIndex = -1;
+    place(index, replacement);
+    // a lower g can only make the state better
+    siftUp(index);
+}
+
+/**
+ * Empties the open list without freeing the states
+ */
+void OpenList::clear() {
+    for (unsigned int i = 0; i < heap.size(); i++) {
+        heap[i]->openIndex = -1;
+    }
+    heap.clear();
+}
+
+/**
+ * Returns whether or not state a should be expanded before state b
+ *@param a the first state
+ *@param b the second state
+ *@return true if a is better than b
+ */
+bool OpenList::better(State* a, State* b) {
+    if (a->getF() != b->getF()) {
+        return a->getF() < b->getF();
+    }
+    // prefer states closer to the goal, they finish the search sooner
+    return a->getH() < b->getH();
+}
+
+/**
+ * Moves the state at the index towards the root until the heap is ordered
+ *@param index the heap slot to fix
+ */
+void OpenList::siftUp(unsigned int index) {
+    State* state = heap[index];
+    while (index > 0) {
+        unsigned int parent = (index-1)/2;
+        if (!better(state, heap[parent])) {
+            break;
+        }
+        place(index, heap[parent]);
+        index = parent;
+    }
+    place(index, state);
+}
+
+/**
+ * Moves the state at the index towards the leaves until the heap is ordered
+ *@param index the heap slot to fix
+ */
+void OpenList::siftDown(unsigned int index) {
+    State* state = heap[index];
+    unsigned int size = heap.size();
+    while (true) {
+        unsigned int child = index*2+1;
+        if (child >= size) {
+            break;
+        }
+        if (child+1 < size && better(heap[child+1], heap[child])) {
+            child++;
+        }
+        if (!better(heap[child], state)) {
+            break;
+        }
+        place(index, heap[child]);
+        index = child;
+    }
+    place(index, state);
+}
+
+/**
+ * Puts a state in a heap slot, updating its handle
+ *@param index the heap slot
+ *@param state the state to put there
+ */
+void OpenList::place(unsigned int index, State* state) {
+    heap[index] = state;
+    state->openIndex = index;
+}
@@ -0,0 +1,301 @@
+#include "parallelsearch.h"
+#include "constants.h"
+#include <climits>
+#include <sched.h>
+
+#define FLUSH_STEPS 64 /**< steps a thread takes before sending the pushes it's holding on to */
+#define ACTIVE_THREAD (1ULL << 32) /**< one active thread in pending, batches count in the low half */
+
+/**
+ * Inits a thread's search
+ *@param level the level to copy
+ *@param size bytes per state
+ */
+ParallelSearch::Worker::Worker(Level& level, unsigned int size): level(level), pool(size) {
+    search = NULL;
+    id = 0;
+    states = 0;
+    steps = 0;
+}
+
+/**
+ * Inits a search
+ *@param _level the loaded level
+ *@param threads how many threads to search with
+ */
+ParallelSearch::ParallelSearch(Level& _level, int threads): level(_level) {
+    unsigned int size = State::getSize(level.getBlocks().size());
+    for (int i = 0; i < threads; i++) {
+        Worker* worker = new Worker(level, size);
+        worker->search = this;
+        worker->id = i;
+        worker->outgoing.assign(threads, NULL);
+        workers.push_back(worker);
+    }
+    bestCost = INT_MAX;
+    best = NULL;
+    pthread_mutex_init(&bestLock, NULL);
+    pending = 0;
+}
+
+/**
+ * Frees every thread's states
+ */
+ParallelSearch::~ParallelSearch() {
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        for (unsigned int j = 0; j < workers[i]->outgoing.size(); j++) {
+            delete workers[i]->outgoing[j];
+        }
+        delete workers[i];
+    }
+    pthread_mutex_destroy(&bestLock);
+}
+
+/**
+ * Searches until the cheapest solution is proven
+ *@return the goal state, NULL if the level has no solution. It lives as long as the search
+ */
+State* ParallelSearch::solve() {
+    Worker* first = workers[0];
+    State* root = first->level.getStart(first->pool);
+    Worker* rootOwner = workers[owner(root->getBlockHash())];
+    if (rootOwner != first) { // build it again where it belongs
+        first->pool.release(root);
+        root = rootOwner->level.getStart(rootOwner->pool);
+    }
+    rootOwner->nodes.insert(root);
+    rootOwner->openlist.push(root);
+    if (root->getH() == 0) {
+        record(root);
+    }
+
+    pending = workers.size()*ACTIVE_THREAD;
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        pthread_create(&workers[i]->thread, NULL, start, workers[i]);
+    }
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        pthread_join(workers[i]->thread, NULL);
+    }
+
+    // the threads learned patterns on their own copies of the level
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        level.getPatterns().merge(workers[i]->level.getPatterns());
+    }
+    return best;
+}
+
+/**
+ * Returns how many states were expanded, over all threads
+ *@return states
+ */
+int ParallelSearch::getStates() {
+    int states = 0;
+    for (unsigned int i = 0; i < workers.size(); i++) {
+        states += workers[i]->states;
+    }
+    return states;
+}
+
+/**
+ * Thread entry point
+ *@param worker the thread's worker
+ *@return NULL
+ */
+void* ParallelSearch::start(void* worker) {
+    ((Worker *)worker)->search->run((Worker *)worker);
+    return NULL;
+}
+
+/**
+ * Runs one thread's search until every thread is out of work
+ *@param worker the thread's worker
+ */
+void ParallelSearch::run(Worker* worker) {
+    bool isActive = true;
+    while (true) {
+        receive(worker, &isActive);
+        if (step(worker)) {
+            if (++worker->steps >= FLUSH_STEPS) {
+                flush(worker);
+            }
+            continue;
+        }
+
+        // out of work: hand everything on, then wait for more or for everyone to finish.
+        // A thread only goes active again by receiving a batch, which is counted as outstanding
+        // from before it's sent until after it's received, so both counts at 0 can't change any more.
+        // They share a word, both read at 0 were both 0 at the same time
+        flush(worker);
+        if (isActive) {
+            isActive = false;
+            __atomic_sub_fetch(&pending, ACTIVE_THREAD, __ATOMIC_SEQ_CST);
+        }
+        if (__atomic_load_n(&pending, __ATOMIC_SEQ_CST) == 0) {
+            break;
+        }
+        sched_yield();
+    }
+}
+
+/**
+ * Builds a push or expands a state, whichever is better, as long as it could beat the best solution
+ *@param worker the thread's worker
+ *@return false if the thread has nothing left worth doing
+ */
+bool ParallelSearch::step(Worker* worker) {
+    int bound = __atomic_load_n(&bestCost, __ATOMIC_ACQUIRE);
+    PushQueue& pushes = worker->pushes;
+    OpenList& openlist = worker->openlist;
+    bool push = !pushes.empty() && pushes.top().f < bound;
+    bool expand = !openlist.empty() && openlist.top()->getF() < bound;
+    if (push && expand) {
+        push = pushes.top().f < openlist.top()->getF() ||
+               (pushes.top().f == openlist.top()->getF() && pushes.top().h < openlist.top()->getH());
+        expand = !push;
+    }
+
+    if (push) {
+        PushQueue::Push next = pushes.pop();
+        NodePool& pool = worker->pool;
+        TranspositionTable& nodes = worker->nodes;
+        State* child = State::create(pool, worker->level, next.parent, next.block, next.direction, next.cost);
+        if (child->getH() == DEAD_END) { // never worth opening
+            pool.release(child);
+            return true;
+        }
+        State* seen = nodes.find(child);
+        if (seen != NULL && child->getG() >= seen->getG()) { // no cheaper
+            pool.release(child);
+            return true;
+        }
+        if (child->getH() == 0) {
+            record(child);
+        }
+        if (seen == NULL) {
+            nodes.insert(child);
+            openlist.push(child);
+        } else if (seen->isOpen()) { // decrease-key, the cheaper copy takes the old one's heap and table slots
+            openlist.replace(seen, child);
+            nodes.replace(seen, child);
+            pool.release(seen);
+        } else {
+            // threads don't expand in global f order, so a state can be expanded before its
+            // cheapest path turns up. Open it again, the old copy stays as other states' parent
+            nodes.replace(seen, child);
+            openlist.push(child);
+        }
+        return true;
+    }
+
+    if (expand) {
+        State* current = openlist.pop();
+        worker->states++;
+        if (current->getH() == 0) { // recorded when it was built
+            return true;
+        }
+        std::vector<PushQueue::Push>& children = worker->children;
+        children.clear();
+        current->getPushes(&children, worker->level);
+        for (unsigned int i = 0; i < children.size(); i++) {
+            if (children[i].f >= bound) {
+                continue;
+            }
+            // the child's blocks are known without building it, which is all the owner depends on
+            int from = current->getBlock(children[i].block);
+            int to = current->getDestination(worker->level, children[i].block, children[i].direction, NULL, NULL);
+            int target = owner(current->getBlockHash()^worker->level.getBlockHash(from)^worker->level.getBlockHash(to));
+            if (target == worker->id) {
+                pushes.push(children[i]);
+            } else {
+                send(worker, target, children[i]);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Moves pushes sent to a thread into its push queue
+ *@param worker the thread's worker
+ *@param isActive (in/out) whether or not the thread counts as active, it does again if anything came
+ */
+void ParallelSearch::receive(Worker* worker, bool* isActive) {
+    Inbox::Batch* batch = worker->inbox.receive();
+    if (batch == NULL) {
+        return;
+    }
+    if (!*isActive) { // before the batches stop counting as outstanding
+        *isActive = true;
+        __atomic_add_fetch(&pending, ACTIVE_THREAD, __ATOMIC_SEQ_CST);
+    }
+    int bound = __atomic_load_n(&bestCost, __ATOMIC_ACQUIRE);
+    while (batch != NULL) {
+        for (unsigned int i = 0; i < batch->count; i++) {
+            if (batch->pushes[i].f < bound) {
+                worker->pushes.push(batch->pushes[i]);
+            }
+        }
+        Inbox::Batch* next = batch->next;
+        delete batch;
+        batch = next;
+        __atomic_sub_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/**
+ * Queues a push for the thread owning its child
+ *@param worker the sending thread's worker
+ *@param target the owning thread
+ *@param push the push
+ */
+void ParallelSearch::send(Worker* worker, int target, PushQueue::Push& push) {
+    Inbox::Batch*& batch = worker->outgoing[target];
+    if (batch == NULL) {
+        batch = new Inbox::Batch;
+        batch->count = 0;
+    }
+    batch->pushes[batch->count++] = push;
+    if (batch->count == INBOX_BATCH) {
+        __atomic_add_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+        workers[target]->inbox.send(batch);
+        batch = NULL;
+    }
+}
+
+/**
+ * Sends every push the thread is holding on to
+ *@param worker the thread's worker
+ */
+void ParallelSearch::flush(Worker* worker) {
+    for (unsigned int i = 0; i < worker->outgoing.size(); i++) {
+        if (worker->outgoing[i] != NULL) {
+            __atomic_add_fetch(&pending, 1, __ATOMIC_SEQ_CST);
+            workers[i]->inbox.send(worker->outgoing[i]);
+            worker->outgoing[i] = NULL;
+        }
+    }
+    worker->steps = 0;
+}
+
+/**
+ * Keeps a solution if it's the cheapest one so far
+ *@param goal the goal state
+ */
+void ParallelSearch::record(State* goal) {
+    pthread_mutex_lock(&bestLock);
+    if (goal->getG() < bestCost) {
+        best = goal;
+        __atomic_store_n(&bestCost, goal->getG(), __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&bestLock);
+}
+
+/**
+ * Returns the thread that owns states with these blocks
+ *@param blockHash the zobrist hash of the blocks
+ *@return the thread
+ */
+int ParallelSearch::owner(uint64_t blockHash) {
+    return (blockHash >> 40)%workers.size();
+}
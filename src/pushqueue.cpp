@@ -0,0 +1,99 @@
+#include "pushqueue.h"
+
+/**
+ * Inits an empty queue
+ */
+PushQueue::PushQueue() {
+}
+
+/**
+ * Returns whether or not the queue is empty
+ *@return true if there are no pushes waiting
+ */
+bool PushQueue::empty() {
+    return heap.empty();
+}
+
+/**
+ * Returns how many pushes are waiting
+ *@return the heap size
+ */
+unsigned int PushQueue::size() {
+    return heap.size();
+}
+
+/**
+ * Adds a push to the queue
+ *@param push the push
+ */
+void PushQueue::push(Push& push) {
+    unsigned int index = heap.size();
+    heap.push_back(push);
+    while (index > 0) {
+        unsigned int up = (index-1)/2;
+        if (!better(push, heap[up])) {
+            break;
+        }
+        heap[index] = heap[up];
+        index = up;
+    }
+    heap[index] = push;
+}
+
+/**
+ * Returns the best push without removing it
+ *@return the push with the lowest f
+ */
+PushQueue::Push& PushQueue::top() {
+    return heap[0];
+}
+
+/**
+ * Removes and returns the best push
+ *@return the push with the lowest f
+ */
+PushQueue::Push PushQueue::pop() {
+    Push top = heap[0];
+    Push last = heap.back();
+    heap.pop_back();
+    unsigned int size = heap.size();
+    if (size) {
+        unsigned int index = 0;
+        while (true) {
+            unsigned int child = index*2+1;
+            if (child >= size) {
+                break;
+            }
+            if (child+1 < size && better(heap[child+1], heap[child])) {
+                child++;
+            }
+            if (!better(heap[child], last)) {
+                break;
+            }
+            heap[index] = heap[child];
+            index = child;
+        }
+        heap[index] = last;
+    }
+    return top;
+}
+
+/**
+ * Empties the queue
+ */
+void PushQueue::clear() {
+    heap.clear();
+}
+
+/**
+ * Returns whether or not push a should be built before push b
+ *@param a the first push
+ *@param b the second push
+ *@return true if a is better than b
+ */
+bool PushQueue::better(Push& a, Push& b) {
+    if (a.f != b.f) {
+        return a.f < b.f;
+    }
+    return a.h < b.h;
+}
@@ -0,0 +1,130 @@
+#include "runfile.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MAX_SHARED 255 /**< the most leading bytes a key can say it repeats, it's kept in a byte */
+
+/**
+ * Inits a run that isn't open yet
+ *@param _keyBytes how big a key is
+ *@param _dataBytes how much data follows each key
+ */
+RunFile::RunFile(unsigned int _keyBytes, unsigned int _dataBytes) {
+    keyBytes = _keyBytes;
+    dataBytes = _dataBytes;
+    last.resize(keyBytes+dataBytes);
+    started = false;
+    out = NULL;
+    mapped = NULL;
+    length = 0;
+    position = 0;
+}
+
+/**
+ * Closes the run if it's still open
+ */
+RunFile::~RunFile() {
+    close();
+}
+
+/**
+ * Starts writing a new run, replacing the file if it's there
+ *@param path the file
+ *@return true on success
+ */
+bool RunFile::create(const std::string& path) {
+    close();
+    out = fopen(path.c_str(), "wb");
+    started = false;
+    return out != NULL;
+}
+
+/**
+ * Writes the next record, records must come in key order
+ *@param record the key and its data
+ */
+void RunFile::append(unsigned char* record) {
+    unsigned int shared = 0;
+    if (started) {
+        while (shared < keyBytes && shared < MAX_SHARED && record[shared] == last[shared]) {
+            shared++;
+        }
+    }
+    fputc(shared, out);
+    fwrite(record+shared, 1, keyBytes+dataBytes-shared, out);
+    memcpy(&last[0], record, keyBytes);
+    started = true;
+}
+
+/**
+ * Opens a run to read its records back
+ *@param path the file
+ *@return true on success
+ */
+bool RunFile::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        ::close(fd);
+        return false;
+    }
+    length = info.st_size;
+    position = 0;
+    started = false;
+    if (length > 0) { // an empty run can't be mapped, it has nothing to read anyway
+        void* data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        madvise(data, length, MADV_SEQUENTIAL);
+        mapped = (unsigned char *)data;
+    }
+    ::close(fd); // the mapping stays valid without it
+    return true;
+}
+
+/**
+ * Reads the next record
+ *@return the key and its data, valid until the next call. NULL after the last record
+ */
+unsigned char* RunFile::next() {
+    if (mapped == NULL || position >= length) {
+        return NULL;
+    }
+    unsigned int shared = mapped[position++];
+    unsigned int rest = keyBytes+dataBytes-shared;
+    memcpy(&last[shared], mapped+position, rest);
+    position += rest;
+    return &last[0];
+}
+
+/**
+ * Closes the run, flushing it if it was being written
+ *@return false if writing it failed
+ */
+bool RunFile::close() {
+    bool ok = true;
+    if (out != NULL) {
+        ok = !ferror(out);
+        if (fclose(out) != 0) {
+            ok = false;
+        }
+        out = NULL;
+    }
+    if (mapped != NULL) {
+        munmap(mapped, length);
+        mapped = NULL;
+    }
+    length = 0;
+    position = 0;
+    return ok;
+}
@@ -0,0 +1,304 @@
+#include "smasearch.h"
+#include "constants.h"
+#include <climits>
+#include <cstring>
+
+#define NO_F INT_MAX /**< f of nothing dropped, or of nothing left to search */
+
+/**
+ * Inits a search
+ *@param _level the loaded level
+ *@param _limit how many states may be kept at once
+ */
+SmaSearch::SmaSearch(Level& _level, unsigned int _limit):
+        level(_level),
+        offset((State::getSize(_level.getBlocks().size())+sizeof(int)-1)/sizeof(int)*sizeof(int)),
+        pool(offset+sizeof(Memo)+4*sizeof(int)*_level.getBlocks().size()) {
+    limit = _limit > 1 ? _limit : 2;
+    kept = 0;
+    root = NULL;
+    expanding = NULL;
+    outOfMemory = false;
+    cut = false;
+    states = 0;
+}
+
+/**
+ * Searches until the cheapest solution is found, the level is proven to have none,
+ * or the path to the cheapest open state doesn't fit in the limit
+ *@return the goal state, NULL if there's no solution. It lives as long as the search
+ */
+State* SmaSearch::solve() {
+    root = level.getStart(pool);
+    if (root->getH() == DEAD_END) {
+        return NULL;
+    }
+    Memo* rootMemo = memo(root);
+    rootMemo->f = root->getF();
+    rootMemo->forgotten = NO_F;
+    rootMemo->children = 0;
+    rootMemo->depth = 0;
+    rootMemo->expanded = false;
+    rootMemo->listed = true;
+    nodes.insert(root);
+    kept = 1;
+    queue(root, rootMemo->f);
+
+    while (!open.empty()) {
+        Open best = *open.begin();
+        open.erase(open.begin());
+        State* state = best.state;
+        if (!memo(state)->expanded && state->getH() == 0) { // goal, nothing open is cheaper
+            return state;
+        }
+
+        states++;
+        if (!expand(state, best.f)) {
+            outOfMemory = true;
+            return NULL;
+        }
+        if (memo(state)->children == 0 && memo(state)->forgotten == NO_F) {
+            if (state == root) {
+                outOfMemory = cut; // only proven to have no solution if nothing was too deep
+                return NULL;
+            }
+            prune(state);
+        }
+    }
+    outOfMemory = cut;
+    return NULL;
+}
+
+/**
+ * Returns whether or not the search gave up because the limit was too small
+ *@return true if a solution might still exist
+ */
+bool SmaSearch::isOutOfMemory() {
+    return outOfMemory;
+}
+
+/**
+ * Returns how many states were expanded, counting the ones built again
+ *@return states
+ */
+int SmaSearch::getStates() {
+    return states;
+}
+
+/**
+ * Orders entries best first, the deepest first on equal f so it's the shallowest that's dropped
+ *@param other the other entry
+ *@return true if this one goes first
+ */
+bool SmaSearch::Open::operator<(const Open& other) const {
+    if (f != other.f) {
+        return f < other.f;
+    }
+    if (g != other.g) {
+        return g > other.g;
+    }
+    return state < other.state;
+}
+
+/**
+ * Builds a state's pushes, or just the ones that were dropped
+ *@param state the state
+ *@param f the f it was queued with, a lower bound for every child
+ *@return false if a child couldn't be kept, nothing could be dropped to make room
+ */
+bool SmaSearch::expand(State* state, int f) {
+    Memo* parent = memo(state);
+    int count = state->getBlockCount();
+    std::vector<PushQueue::Push> pushes;
+    std::vector<int> raises; // how far above its own f each child's search had got before it was dropped
+    if (!parent->expanded) {
+        parent->expanded = true;
+        state->getPushes(&pushes, level);
+        raises.assign(pushes.size(), 0);
+    } else {
+        int* dropped = forgotten(state);
+        PushQueue::Push push;
+        push.parent = state;
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < 4; j++) {
+                if (dropped[i*4+j]) {
+                    push.block = i;
+                    push.direction = j;
+                    push.cost = state->getPushCost(level, i, j);
+                    pushes.push_back(push);
+                    raises.push_back(dropped[i*4+j]-1);
+                    dropped[i*4+j] = 0;
+                }
+            }
+        }
+        parent->forgotten = NO_F;
+    }
+
+    expanding = state;
+    for (unsigned int i = 0; i < pushes.size(); i++) {
+        State* child = State::create(pool, level, state, pushes[i].block, pushes[i].direction, pushes[i].cost);
+        if (child->getH() == DEAD_END) { // never worth keeping
+            pool.release(child);
+        } else if (child->getH() > 0 && parent->depth+2 >= limit) { // its children couldn't be kept next to its path
+            pool.release(child);
+            cut = true;
+        } else if (!add(state, child, child->getF()+raises[i] > f ? child->getF()+raises[i] : f)) {
+            expanding = NULL;
+            return false;
+        }
+    }
+    expanding = NULL;
+    return true;
+}
+
+/**
+ * Keeps a child, unless it's a position already kept at no more cost
+ * At the limit, the worst open leaves are dropped first to make room for it
+ *@param parent the expanded state
+ *@param child the new child
+ *@param f the lower bound the parent was queued with
+ *@return false if nothing could be dropped, the child is freed
+ */
+bool SmaSearch::add(State* parent, State* child, int f) {
+    State* seen = nodes.find(child);
+    if (seen != NULL && child->getG() >= seen->getG()) { // kept already
+        pool.release(child);
+        return true;
+    }
+    while (kept >= limit) {
+        if (!evict()) {
+            pool.release(child);
+            return false;
+        }
+    }
+    seen = nodes.find(child); // it may have been the one dropped
+    if (seen != NULL && memo(seen)->expanded) {
+        // its children are kept so it stays in the tree, the cheaper copy is the one found from now on
+        nodes.replace(seen, child);
+        memo(seen)->listed = false;
+    } else if (seen != NULL) {
+        // the cheaper copy takes over, the old one's parent has one child less
+        Open old = {memo(seen)->f, seen->getG(), seen};
+        open.erase(old);
+        nodes.replace(seen, child);
+        State* oldParent = seen->getParent();
+        pool.release(seen);
+        kept--;
+        memo(oldParent)->children--;
+        if (memo(oldParent)->children == 0 && memo(oldParent)->forgotten == NO_F && oldParent != root) {
+            prune(oldParent);
+        }
+    } else {
+        nodes.insert(child);
+    }
+
+    Memo* m = memo(child);
+    m->f = child->getF() > f ? child->getF() : f; // a child is never cheaper than what its parent was queued with
+    m->forgotten = NO_F;
+    m->children = 0;
+    m->depth = memo(parent)->depth+1;
+    m->expanded = false;
+    m->listed = true;
+    memset(forgotten(child), 0, 4*sizeof(int)*child->getBlockCount());
+    memo(parent)->children++;
+    kept++;
+    queue(child, m->f);
+    return true;
+}
+
+/**
+ * Drops the open leaf with the worst f, backing it up into its parent
+ *@return false if there's nothing that can be dropped
+ */
+bool SmaSearch::evict() {
+    std::set<Open>::reverse_iterator worst = open.rbegin();
+    while (worst != open.rend() && (worst->state == root || worst->state == expanding || memo(worst->state)->children > 0)) {
+        worst++;
+    }
+    if (worst == open.rend()) {
+        return false;
+    }
+    State* state = worst->state;
+    int f = worst->f;
+    open.erase(*worst);
+
+    // the parent remembers the push and how far its f was raised, and that nothing it dropped is cheaper than f
+    State* parent = state->getParent();
+    Memo* parentMemo = memo(parent);
+    int from = state->getPushedCell(level);
+    int raise = f > state->getF() ? f-state->getF() : 0;
+    for (int i = 0; i < parent->getBlockCount(); i++) {
+        if (parent->getBlock(i) == from) {
+            forgotten(parent)[i*4+state->getPushDirection()] = raise+1;
+            break;
+        }
+    }
+    parentMemo->children--;
+    if (f < parentMemo->forgotten) {
+        parentMemo->forgotten = f;
+    }
+    queue(parent, parentMemo->forgotten);
+    remove(state);
+    return true;
+}
+
+/**
+ * Drops a leaf that has nothing left to search, and any parents that leaves with nothing
+ *@param state the leaf
+ */
+void SmaSearch::prune(State* state) {
+    // the state being expanded may have no children yet, it's checked once it's done
+    while (state != root && state != expanding && memo(state)->children == 0 && memo(state)->forgotten == NO_F) {
+        State* parent = state->getParent();
+        Open entry = {memo(state)->f, state->getG(), state};
+        open.erase(entry);
+        remove(state);
+        memo(parent)->children--;
+        state = parent;
+    }
+}
+
+/**
+ * Queues a state, taking it out of the open list first if it's already there
+ *@param state the state
+ *@param f its new f
+ */
+void SmaSearch::queue(State* state, int f) {
+    Memo* m = memo(state);
+    Open entry = {m->f, state->getG(), state};
+    open.erase(entry);
+    m->f = f;
+    entry.f = f;
+    open.insert(entry);
+}
+
+/**
+ * Frees a state that's been taken out of the tree
+ *@param state the state
+ */
+void SmaSearch::remove(State* state) {
+    if (memo(state)->listed) {
+        nodes.remove(state);
+    }
+    pool.release(state);
+    kept--;
+}
+
+/**
+ * Returns a state's SMA* data
+ *@param state the state
+ *@return memo
+ */
+SmaSearch::Memo* SmaSearch::memo(State* state) {
+    return (Memo *)((char *)state+offset);
+}
+
+/**
+ * Returns the pushes of a state that were dropped, one per direction for each block.
+ * 0 for kept or never built, otherwise 1 more than how far its f was raised above its own
+ *@param state the state
+ *@return 4 per block
+ */
+int* SmaSearch::forgotten(State* state) {
+    return (int *)(memo(state)+1);
+}
@@ -1,4 +1,10 @@
 #include "sokostar.h"
+#include "parallelsearch.h"
+#include "bidirectionalsearch.h"
+#include "idasearch.h"
+#include "smasearch.h"
+#include "externalsearch.h"
+#include "anytimesearch.h"
 #include <vector>
 #include <cstdio>
 #include <sys/time.h>
@@ -8,6 +14,19 @@
  * Inits a new SokoStar solver
  */
 SokoStar::SokoStar() {
+    threads = 1;
+    verbose = true;
+    bidirectional = false;
+    idaMemory = 0;
+    smaLimit = 0;
+    anytimeMsec = 0;
+    anytimeStates = 0;
+    goalMacros = false;
+    costModel = COST_SWITCHES;
+    solved = false;
+    outOfBudget = false;
+    msec = 0;
+    states = 0;
 }
 
 /**
@@ -17,57 +36,219 @@ SokoStar::SokoStar() {
  */
 bool SokoStar::load(char* file) {
     printf("Loading file: %s\n", file);
-    return level.load(file);
+    if (!level.load(file)) {
+        return false;
+    }
+    if (patternFile.empty()) {
+        return true;
+    }
+    int patterns = level.getPatterns().load(patternFile.c_str());
+    if (patterns) {
+        printf("Loaded %d deadlock patterns from %s\n", patterns, patternFile.c_str());
+    }
+    return true;
+}
+
+/**
+ * Loads a level from its map, without reading the pattern file
+ *@param map the level's map, one row per line
+ *@return true on success, false if there was a problem loading the level
+ */
+bool SokoStar::parse(std::string& map) {
+    return level.parse(map);
+}
+
+/**
+ * Sets how many threads to search with
+ *@param _threads the thread count, 1 searches on this thread alone
+ */
+void SokoStar::setThreads(int _threads) {
+    threads = _threads > 0 ? _threads : 1;
+}
+
+/**
+ * Sets whether or not to print progress and keep the pattern file up to date
+ *@param _verbose false to solve quietly
+ */
+void SokoStar::setVerbose(bool _verbose) {
+    verbose = _verbose;
+}
+
+/**
+ * Sets whether or not to search from the goals as well as from the start
+ *@param _bidirectional true to search both ways, giving up on the cheapest solution
+ */
+void SokoStar::setBidirectional(bool _bidirectional) {
+    bidirectional = _bidirectional;
+}
+
+/**
+ * Sets how much memory IDA* may use for its transposition table, instead of searching with A*
+ *@param _megabytes the table size, 0 searches with A*
+ */
+void SokoStar::setIdaMemory(int _megabytes) {
+    idaMemory = _megabytes > 0 ? _megabytes : 0;
+}
+
+/**
+ * Sets how many states SMA* may keep, instead of searching with A*
+ *@param _states the limit, 0 searches with A*
+ */
+void SokoStar::setSmaLimit(int _states) {
+    smaLimit = _states > 0 ? _states : 0;
+}
+
+/**
+ * Sets a directory to keep the search in files, instead of searching with A* in memory
+ *@param _directory the directory, empty searches with A*
+ */
+void SokoStar::setExternalDirectory(std::string& _directory) {
+    externalDirectory = _directory;
+}
+
+/**
+ * Sets a budget to search with ARA*, taking the best solution found within it
+ *@param _msec how long it may search, 0 for no limit
+ *@param _states how many states it may expand, 0 for no limit. Both 0 searches with A*
+ */
+void SokoStar::setAnytime(int _msec, int _states) {
+    anytimeMsec = _msec > 0 ? _msec : 0;
+    anytimeStates = _states > 0 ? _states : 0;
+}
+
+/**
+ * Sets whether or not to fill a goal room in a fixed order, pushing each block from its entrance straight to its goal
+ *@param _goalMacros true to pack the goal room, giving up on the cheapest solution
+ */
+void SokoStar::setGoalMacros(bool _goalMacros) {
+    goalMacros = _goalMacros;
+}
+
+/**
+ * Sets what the cheapest solution is cheapest in
+ *@param _costModel COST_SWITCHES, COST_PUSHES, COST_PUSHES_MOVES or COST_MOVES_PUSHES
+ */
+void SokoStar::setCostModel(int _costModel) {
+    costModel = _costModel;
+}
+
+/**
+ * Sets a file to load deadlock patterns from, and to save the ones learned to
+ *@param _patternFile the file, empty to neither load nor save patterns
+ */
+void SokoStar::setPatternFile(std::string& _patternFile) {
+    patternFile = _patternFile;
 }
 
 /**
  * Solves the problem
  */
 void SokoStar::solve() {
-    std::map<std::string, State *> closedset;
-    std::map<std::string, State *> openset;
-    openset[level.getStart()->get()] = level.getStart();
-
-    printf("Searching for a solution...\n");
+    // with spare blocks the goals don't say where every block ends up, so there's nowhere to pull from
+    bool both = bidirectional && !level.hasSpareBlocks();
+    if (verbose && bidirectional && !both) {
+        printf("Spare blocks can end up anywhere, only searching forward\n");
+    }
+    // every copy of the level made for the search takes the cost model with it
+    level.setCostModel(costModel);
+    if (goalMacros) {
+        level.findGoalRoom();
+        if (verbose && level.getRoomEntrance() != -1) {
+            printf("Packing the %d goals of the goal room in a fixed order\n", level.getPackingSize());
+        } else if (verbose) {
+            printf("No goal room with a single entrance and a packing order, searching without macros\n");
+        }
+    }
+    if (verbose && both) {
+        printf("Searching for a solution from the start and the goals...\n");
+    } else if (verbose && idaMemory) {
+        printf("Searching for a solution with IDA* in %d MB...\n", idaMemory);
+    } else if (verbose && (anytimeMsec || anytimeStates)) {
+        printf("Searching for better and better solutions with ARA*...\n");
+    } else if (verbose && !externalDirectory.empty()) {
+        printf("Searching for a solution with its states in %s...\n", externalDirectory.c_str());
+    } else if (verbose && smaLimit) {
+        printf("Searching for a solution with SMA*, keeping at most %d states...\n", smaLimit);
+    } else if (verbose && threads > 1) {
+        printf("Searching for a solution with %d threads...\n", threads);
+    } else if (verbose) {
+        printf("Searching for a solution...\n");
+    }
 
+    solved = false;
+    outOfBudget = false;
     msec = 0;
     states = 0;
     struct timeval start;
     struct timeval end;
     gettimeofday(&start, NULL);
 
-    //A* states
-    while (!openset.empty()) {
-        State* current = best(openset);
-
-        openset.erase(current->get());
-        closedset[current->get()] = current;
-
-        states++;
-
-        if (current->getH() == 0) { // goal
-            buildPath(current);
-            break;
+    if (both) {
+        BidirectionalSearch search(level);
+        if (search.solve()) {
+            buildPath(search.getForward(), search.getBackward());
         }
-
-        std::vector<State *> children;
-        current->getChildren(&children, level);
-        for (unsigned int i = 0; i < children.size(); i++) {
-            if (closedset.count(children[i]->get())) {
-                continue;
+        states = search.getStates();
+    } else if (idaMemory) {
+        IdaSearch search(level, idaMemory);
+        State* goal = search.solve();
+        if (goal != NULL) {
+            buildPath(goal);
+        }
+        states = search.getStates();
+    } else if (anytimeMsec || anytimeStates) {
+        AnytimeSearch search(level, anytimeMsec, anytimeStates);
+        State* built = NULL;
+        State* goal;
+        while ((goal = search.improve()) != NULL) {
+            if (goal != built) { // the path is only kept for the best solution
+                rBlocksPushed.clear();
+                rPushDirection.clear();
+                buildPath(goal);
+                built = goal;
             }
-
-            if (!openset.count(children[i]->get()) || children[i]->getG() < openset[children[i]->get()]->getG()) {
-                if (openset.count(children[i]->get())) {
-                    delete openset[children[i]->get()];
-                }
-                openset[children[i]->get()] = children[i];
+            if (verbose) {
+                printf("Solution costing %d after %.0f msec and %d states, at most %.2f times the cheapest\n",
+                        goal->getG(), search.getMsec(), search.getStates(), search.getBound());
             }
         }
+        outOfBudget = search.isOutOfBudget();
+        if (verbose && !solved && outOfBudget) {
+            printf("Gave up, no solution was found within the budget\n");
+        }
+        states = search.getStates();
+    } else if (!externalDirectory.empty()) {
+        ExternalSearch search(level, externalDirectory);
+        State* goal = search.solve();
+        if (goal != NULL) {
+            buildPath(goal);
+        } else if (search.hasFailed()) {
+            printf("Error, couldn't use the search files in %s\n", externalDirectory.c_str());
+        }
+        states = search.getStates();
+    } else if (smaLimit) {
+        SmaSearch search(level, smaLimit);
+        State* goal = search.solve();
+        if (goal != NULL) {
+            buildPath(goal);
+        } else if (verbose && search.isOutOfMemory()) {
+            printf("Gave up, the path to the next state doesn't fit in %d states\n", smaLimit);
+        }
+        states = search.getStates();
+    } else if (threads > 1) {
+        ParallelSearch parallel(level, threads);
+        State* goal = parallel.solve();
+        if (goal != NULL) {
+            buildPath(goal);
+        }
+        states = parallel.getStates();
+    } else {
+        search();
     }
 
-    // now get the robot paths
+    // now get the robot paths, states only know which cell was pushed so find the block there
     for (int i = (int)rBlocksPushed.size()-1; i >= 0; i--) {
+        rBlocksPushed[i] = level.getBlockAt(rBlocksPushed[i]);
         rRobotMovements.push_back(std::vector<int>());
         level.pushBlock(rBlocksPushed[i], rPushDirection[i], &rRobotMovements[rRobotMovements.size()-1]);
     }
@@ -76,16 +257,79 @@ void SokoStar::solve() {
     msec = (end.tv_sec-start.tv_sec)*1000.f+(end.tv_usec-start.tv_usec)/1000.f;
     //msec = clock()-start;///CLOCKS_PER_SEC*1000;
 
-    for (std::map<std::string, State *>::iterator i = openset.begin(); i != openset.end(); i++) {
-        delete i->second;
+    if (verbose && solved && !level.isCostExact(getPushCount(), getMoveCount())) {
+        printf("The solution is too long for the cost model to rank exactly, it may not be the cheapest\n");
     }
-    for (std::map<std::string, State *>::iterator i = closedset.begin(); i != closedset.end(); i++) {
-        if (i->first != level.getStart()->get()) {
-            delete i->second;
-        }
+
+    if (patternFile.empty()) {
+        return;
+    }
+    DeadlockPatterns& patterns = level.getPatterns();
+    int learned = patterns.getLearned();
+    if (learned && !patterns.save(patternFile.c_str())) {
+        printf("Error writing deadlock patterns to %s\n", patternFile.c_str());
+    } else if (learned) {
+        printf("Learned %d new deadlock patterns, %d now saved in %s\n", learned, patterns.size(), patternFile.c_str());
     }
+}
 
+/**
+ * Runs A* on this thread, building the path if a solution is found
+ */
+void SokoStar::search() {
+    NodePool pool(State::getSize(level.getBlocks().size()));
+    TranspositionTable nodes;
+    OpenList openlist;
+    PushQueue pushes;
+    std::vector<PushQueue::Push> children;
+    State* root = level.getStart(pool);
+    nodes.insert(root);
+    openlist.push(root);
 
+    //A* states
+    while (!openlist.empty() || !pushes.empty()) {
+        // a queued push whose bound beats every built state gets built, and waits its turn like any other
+        if (!pushes.empty() && (openlist.empty() || pushes.top().f < openlist.top()->getF() ||
+                (pushes.top().f == openlist.top()->getF() && pushes.top().h < openlist.top()->getH()))) {
+            PushQueue::Push push = pushes.pop();
+            State* child = State::create(pool, level, push.parent, push.block, push.direction, push.cost);
+            if (child->getH() == DEAD_END) { // never worth opening
+                pool.release(child);
+                continue;
+            }
+            State* seen = nodes.find(child);
+            if (seen == NULL) {
+                nodes.insert(child);
+                openlist.push(child);
+            } else if (seen->isOpen() && child->getG() < seen->getG()) {
+                // decrease-key, the cheaper copy takes the old one's heap and table slots
+                openlist.replace(seen, child);
+                nodes.replace(seen, child);
+                pool.release(seen);
+            } else { // already expanded, or no cheaper
+                pool.release(child);
+            }
+            continue;
+        }
+
+        State* current = openlist.pop();
+
+        states++;
+
+        if (current->getH() == 0) { // goal
+            buildPath(current);
+            break;
+        }
+
+        children.clear();
+        current->getPushes(&children, level);
+        for (unsigned int i = 0; i < children.size(); i++) {
+            pushes.push(children[i]);
+        }
+    }
+
+    // every state lives in the pool, no need to walk the table
+    pool.reset();
 }
 
 /**
@@ -97,7 +341,7 @@ void SokoStar::printSolution() {
         fprintf(f, "Error writing results to results.txt\n");
     }
     printf("\n");
-    if (!rBlocksPushed.size()) {
+    if (!solved) {
         printf("This level has no solution\n");
         if (f != NULL) {
             fprintf(f, "This level has no solution\n");
@@ -151,18 +395,63 @@ void SokoStar::printSolution() {
 }
 
 /**
- * Grabs the best guess from the openset
- *@param openset the open set
- *@return the bets guess of where to go next
+ * Returns whether or not the last solve found a solution
+ *@return solved
  */
-State* SokoStar::best(std::map<std::string, State *>& openset) {
-    State* best = NULL;
-    for (std::map<std::string, State *>::iterator i = openset.begin(); i != openset.end(); i++) {
-        if (best == NULL || i->second->getF() < best->getF()) {
-            best = i->second;
-        }
+bool SokoStar::isSolved() {
+    return solved;
+}
+
+/**
+ * Returns whether or not the last solve stopped at its ARA* budget, before proving it had the cheapest solution
+ *@return true if it ran out of time or states
+ */
+bool SokoStar::isOutOfBudget() {
+    return outOfBudget;
+}
+
+/**
+ * Returns how many pushes the solution takes
+ *@return the pushes
+ */
+int SokoStar::getPushCount() {
+    return rBlocksPushed.size();
+}
+
+/**
+ * Returns how many robot steps the solution takes, pushes included
+ *@return the moves
+ */
+int SokoStar::getMoveCount() {
+    int moves = rBlocksPushed.size();
+    for (unsigned int i = 0; i < rRobotMovements.size(); i++) {
+        moves += rRobotMovements[i].size();
     }
-    return best;
+    return moves;
+}
+
+/**
+ * Returns how many block states the last solve expanded
+ *@return states
+ */
+int SokoStar::getStates() {
+    return states;
+}
+
+/**
+ * Returns how long the last solve took
+ *@return msec
+ */
+float SokoStar::getMsec() {
+    return msec;
+}
+
+/**
+ * Returns the deadlock patterns the level is searched with
+ *@return patterns
+ */
+DeadlockPatterns& SokoStar::getPatterns() {
+    return level.getPatterns();
 }
 
 /**
@@ -170,18 +459,53 @@ State* SokoStar::best(std::map<std::string, State *>& openset) {
  *@param node the end state
  */
 void SokoStar::buildPath(State* node) {
+    solved = true;
     while (node != NULL) {
         //node->print();
         //printf("\n");
         if (node->getParent() != NULL) { //ie- not the start node
-            rBlocksPushed.push_back(node->getBlockPushedIndex());
-            rPushDirection.push_back(node->getPushDirection());
+            // a push through a tunnel is a push per cell, the last one goes first
+            int direction = node->getPushDirection();
+            int cell = node->getMoved();
+            if (node->isPacked()) { // then on from the goal room's entrance to its goal
+                int step = level.getPackingStep(cell);
+                std::vector<int>& cells = level.getPackingCells(step);
+                std::vector<int>& directions = level.getPackingDirections(step);
+                for (int i = (int)cells.size()-1; i >= 0; i--) {
+                    rBlocksPushed.push_back(cells[i]);
+                    rPushDirection.push_back(directions[i]);
+                }
+                cell = level.getRoomEntrance();
+            }
+            for (int i = 0; i < node->getSteps(); i++) {
+                cell = level.neighbour(cell, direction^1);
+                rBlocksPushed.push_back(cell); // turned into a block index when replayed
+                rPushDirection.push_back(direction);
+            }
             //rRobotMovements.push_back(node->getBlockPushedPath());
         }
         node = node->getParent();
     }
 }
 
+/**
+ * Builds the path through the state where the forward and backward searches met
+ *@param forward the forward state, the pushes up to it come first
+ *@param backward the backward state, the pushes undoing its pulls come after
+ */
+void SokoStar::buildPath(State* forward, State* backward) {
+    // the path is kept last push first, and the pull next to the goals is undone last
+    std::vector<State *> pulls;
+    for (State* node = backward; node != NULL && node->getParent() != NULL; node = node->getParent()) {
+        pulls.push_back(node);
+    }
+    for (int i = (int)pulls.size()-1; i >= 0; i--) {
+        rBlocksPushed.push_back(pulls[i]->getPushedCell(level));
+        rPushDirection.push_back(pulls[i]->getPushDirection());
+    }
+    buildPath(forward);
+}
+
 /**
  * Translates the direction constant to a string
  *@param direction the direction to translate
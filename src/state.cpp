@@ -1,150 +1,500 @@
 #include "state.h"
 #include "level.h"
-#include <cmath>
+#include "workspace.h"
+#include "nodepool.h"
+#include "corral.h"
+#include "deadlockpatterns.h"
+#include <cstring>
+#include <climits>
+#include <algorithm>
+#include <new>
 #include "constants.h"
 
 #include <cstdio>
 
 /**
- * Inits a new state from the level
+ * Builds the starting state of a level
+ *@param pool the pool to put the state in
+ *@param level the level
+ *@return the new state
  */
-State::State(Level& level)/*: goals(level.getGoals())*/ {
+State* State::create(NodePool& pool, Level& level) {
+    std::vector<int> blocks;
+    for (unsigned int i = 0; i < level.getBlocks().size(); i++) {
+        blocks.push_back(level.getBlocks()[i]->getX()+level.getBlocks()[i]->getY()*level.getWidth());
+    }
+    return new (pool.allocate()) State(level, blocks, level.getRobot()->getX()+level.getRobot()->getY()*level.getWidth(), false);
+}
+
+/**
+ * Builds a state with the robot and blocks somewhere else than at the start
+ *@param pool the pool to put the state in
+ *@param level the level
+ *@param blocks the cells holding blocks
+ *@param robot the robot's cell
+ *@return the new state
+ */
+State* State::create(NodePool& pool, Level& level, std::vector<int>& blocks, int robot) {
+    return new (pool.allocate()) State(level, blocks, robot, false);
+}
+
+/**
+ * Builds a state a backward search starts from, its children are pulls
+ *@param pool the pool to put the state in
+ *@param level the reversed level
+ *@param blocks the cells holding blocks
+ *@param robot the robot's cell
+ *@return the new state
+ */
+State* State::createBackward(NodePool& pool, Level& level, std::vector<int>& blocks, int robot) {
+    return new (pool.allocate()) State(level, blocks, robot, true);
+}
+
+/**
+ * Builds a state that was written out to disk, carrying on from where its path left it
+ *@param pool the pool to put the state in
+ *@param level the level
+ *@param blocks the cells holding blocks
+ *@param robot the robot's cell
+ *@param _g the cost it was reached with
+ *@param _moved the cell of the block pushed last, -1 for the start state
+ *@return the new state, without a parent
+ */
+State* State::create(NodePool& pool, Level& level, std::vector<int>& blocks, int robot, int _g, int _moved) {
+    State* state = new (pool.allocate()) State(level, blocks, robot, false);
+    state->g = _g;
+    state->moved = _moved; // the next push costs the same as it would have on the path
+    return state;
+}
+
+/**
+ * Builds the state a queued push, or pull for a backward parent, leads to
+ *@param pool the pool to put the state in
+ *@param level the level, reversed for a backward parent
+ *@param parent the state the push is made from
+ *@param block which block of the parent (position in cells) is pushed
+ *@param direction the direction it moves
+ *@param cost what the push adds to the parent's g, from getPushCost
+ *@return the new state, with h at DEAD_END if it's deadlocked
+ */
+State* State::create(NodePool& pool, Level& level, State* parent, unsigned int block, int direction, int cost) {
+    return new (pool.allocate()) State(parent, level, block, direction, cost);
+}
+
+/**
+ * Returns how many bytes a state takes, including the inline block cells
+ *@param blocks how many blocks there are
+ *@return the node size for the pool
+ */
+unsigned int State::getSize(unsigned int blocks) {
+    return sizeof(State)+blocks*(2*sizeof(unsigned short)+sizeof(unsigned char));
+}
+
+/**
+ * Inits a new state with no parent
+ *@param level the level
+ *@param blocks the cells holding blocks
+ *@param robot the robot's cell
+ *@param _backward whether or not the state pulls blocks
+ */
+State::State(Level& level, std::vector<int>& blocks, int robot, bool _backward)/*: goals(level.getGoals())*/ {
+    backward = _backward;
     parent = NULL;
-    blockPushed = -1;
+    moved = -1;
+    steps = 0;
     pushDirection = -1;
-
-    width = level.getWidth();
+    openIndex = -1;
+    packed = false;
 
     // build state representation
-    //wall_map = level.getWallMap();
-    value = level.getWallMap();//*wall_map;
-    value[level.getRobot()->getX()+level.getRobot()->getY()*width] = ROBOT;
-    for (unsigned int i = 0; i < level.getBlocks().size(); i++) {
-        int index = level.getBlocks()[i]->getX()+level.getBlocks()[i]->getY()*width;
-        value[index] = BLOCK;
-        blocks.push_back(new Block(level.getBlocks()[i]->getX(), level.getBlocks()[i]->getY()));
-        blocksPos[index] = blocks[i];
-    }
-
-    for (unsigned int i = 0; i < level.getGoals().size(); i++) {
-        int index = level.getGoals()[i]->getX()+level.getGoals()[i]->getY()*width;
-        if (value[index] == ROBOT) {
-            value[index] = ROBOT_ON_GOAL;
-        } else if (value[index] == BLOCK) {
-            value[index] = BLOCK_ON_GOAL;
-        } else {
-            value[index] = GOAL;
+    count = blocks.size();
+    unsigned short* sorted = cells();
+    blockHash = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        int index = blocks[i];
+        blockHash ^= level.getBlockHash(index);
+
+        // insertion sort, the key needs the blocks in cell order
+        unsigned int j = i;
+        while (j > 0 && sorted[j-1] > index) {
+            sorted[j] = sorted[j-1];
+            j--;
         }
+        sorted[j] = index;
     }
+    memset(pushable(), 0, count);
 
     g = 0;
-    evaluate(level.getGoals());
-
-    if (h) {
-        floodFill(level.getRobot()->getX(), level.getRobot()->getY());
+    evaluate(level);
+
+    region = robot;
+    // backward states always need their region, to be matched with forward ones
+    if (h != DEAD_END && (h || backward)) {
+        placeBlocks(level.getWorkspace());
+        floodFill(level, robot);
+        findCorral(level);
     }
+    hash = blockHash^level.getRobotHash(region);
 }
 
 /**
- * Frees any memory used by the state
+ * Returns the zobrist hash of this state
+ *@return hash
  */
-State::~State() {
-    for (unsigned int i = 0; i < blocks.size(); i++) {
-        delete blocks[i];
-    }
-    blocksPos.clear();
-    blocks.clear();
+uint64_t State::getHash() {
+    return hash;
 }
 
 /**
- * Returns the representation of this state
- *@return value
+ * Returns whether or not two states have the same blocks and robot region
+ *@param other the state to compare against
+ *@return true if they are the same position
  */
-std::string State::get() {
-    return value;
+bool State::sameAs(State* other) {
+    return region == other->region && !memcmp(cells(), other->cells(), count*sizeof(unsigned short));
 }
 
 /**
- * Floodfills the robot's location
- *@param x robot's x coordinate
- *@param y robot's y coordinate
+ * Returns the cells holding blocks, sorted, stored right after the state
+ *@return count cells
  */
-void State::floodFill(int x, int y) {
-    floodFill(x-1, y, LEFT);
-    floodFill(x+1, y, RIGHT);
-    floodFill(x, y-1, UP);
-    floodFill(x, y+1, DOWN);
+unsigned short* State::cells() {
+    return (unsigned short *)(this+1);
 }
 
 /**
- * Floodfills from a direction
- *@param x robot's x coordinate
- *@param y robot's y coordinate
- *@param dir the direction
+ * Returns the goal each block in cells is matched to by the heuristic, stored after the cells
+ *@return count columns of the matching
  */
-void State::floodFill(int x, int y, int dir) {
-    int index = x+y*width;
-    if (value[index] == EMPTY || value[index] == GOAL) {
-        if (value[index] == EMPTY) {
-            value[index] = ROBOT;
-        } else {
-            value[index] = ROBOT_ON_GOAL;
-        }
+unsigned short* State::assignment() {
+    return cells()+count;
+}
 
-        if (dir != RIGHT) {
-            floodFill(x-1, y, LEFT);
-        }
-        if (dir != LEFT) {
-            floodFill(x+1, y, RIGHT);
+/**
+ * Returns the directions each block in cells can be pushed, a bit per direction,
+ * or pulled for a backward state
+ *@return count bitmasks
+ */
+unsigned char* State::pushable() {
+    return (unsigned char *)(assignment()+count);
+}
+
+/**
+ * Returns whether or not this state is waiting in the open list
+ *@return true if the state has an open list slot
+ */
+bool State::isOpen() {
+    return openIndex != -1;
+}
+
+/**
+ * Returns whether or not this state belongs to a backward search
+ *@return backward
+ */
+bool State::isBackward() {
+    return backward;
+}
+
+/**
+ * Floodfills the robot's location, finding the region and the pushable blocks,
+ * or pullable ones for a backward state
+ * The blocks must already be placed in the workspace
+ *@param level the level this state is in
+ *@param robot the robot's cell
+ */
+void State::floodFill(Level& level, int robot) {
+    Workspace& workspace = level.getWorkspace();
+    int lowest = workspace.reach(robot);
+    region = level.countsMoves() ? robot : lowest; // moves from here depend on the exact cell
+    if (backward) {
+        workspace.findPulls(pushable());
+    } else {
+        workspace.findPushes(pushable());
+    }
+}
+
+/**
+ * Returns whether or not a block is stuck for good, along with every block holding it in place
+ * Blocks still being checked further up count as walls, so blocks locking each other are frozen
+ *@param level the level this state is in
+ *@param index the cell of the block
+ *@param offGoal (out) set if a frozen block is not on a goal
+ *@return true if the block can never be pushed again
+ */
+bool State::isFrozen(Level& level, int index, bool* offGoal) {
+    Workspace& workspace = level.getWorkspace();
+    workspace.visit(index);
+    bool stuckOffGoal = level.getGoalAt(index) == -1;
+    bool frozen = isBlockedOnAxis(level, index, LEFT, &stuckOffGoal) && isBlockedOnAxis(level, index, UP, &stuckOffGoal);
+    workspace.unvisit(index);
+    if (frozen && stuckOffGoal) {
+        *offGoal = true;
+    }
+    return frozen;
+}
+
+/**
+ * Returns whether or not a block can't move along an axis
+ *@param level the level this state is in
+ *@param index the cell of the block
+ *@param direction one side of the axis, the other side is direction^1
+ *@param offGoal (out) set if a block this one leans on is frozen off a goal
+ *@return true if the block can't be pushed either way along the axis
+ */
+bool State::isBlockedOnAxis(Level& level, int index, int direction, bool* offGoal) {
+    Workspace& workspace = level.getWorkspace();
+    int a = level.neighbour(index, direction);
+    int b = level.neighbour(index, direction^1);
+    if (a == -1 || b == -1) {
+        return true;
+    }
+    if (level.isDead(a) && level.isDead(b)) { // both pushes are pruned anyway
+        return true;
+    }
+
+    int sides[2] = {a, b};
+    for (int i = 0; i < 2; i++) {
+        if (workspace.getBlock(sides[i]) == -1) {
+            continue;
         }
-        if (dir != DOWN) {
-            floodFill(x, y-1, UP);
+        if (workspace.isVisited(sides[i])) { // being checked further up, acts as a wall
+            return true;
         }
-        if (dir != UP) {
-            floodFill(x, y+1, DOWN);
+        bool sideOffGoal = false;
+        if (isFrozen(level, sides[i], &sideOffGoal)) {
+            if (sideOffGoal) {
+                *offGoal = true;
+            }
+            return true;
         }
-    } else if (value[index] == BLOCK || value[index] == BLOCK_ON_GOAL) {
-        // check if the block can be pushed from here
-        switch (dir) {
-            case UP:
-                if (value[index-width] != WALL && value[index-width] != BLOCK && value[index-width] != BLOCK_ON_GOAL) {
-                    blocksPos[index]->canPush(UP);
-                }
-                break;
-            case DOWN:
-                if (value[index+width] != WALL && value[index+width] != BLOCK && value[index+width] != BLOCK_ON_GOAL) {
-                    blocksPos[index]->canPush(DOWN);
-                }
-                break;
-            case LEFT:
-                if (value[index-1] != WALL && value[index-1] != BLOCK && value[index-1] != BLOCK_ON_GOAL) {
-                    blocksPos[index]->canPush(LEFT);
-                }
-                break;
-            case RIGHT:
-                if (value[index+1] != WALL && value[index+1] != BLOCK && value[index+1] != BLOCK_ON_GOAL) {
-                    blocksPos[index]->canPush(RIGHT);
-                }
-                break;
+    }
+    return false;
+}
+
+/**
+ * Returns whether or not pushing a block to its cell froze blocks off goals
+ * Known deadlock patterns are looked up first, they're learned from deadlocked corrals
+ *@param level the level this state is in
+ *@return true if the state can never be solved
+ */
+bool State::isDeadlocked(Level& level) {
+    if (level.hasSpareBlocks()) { // a frozen spare block is fine
+        return false;
+    }
+    DeadlockPatterns& patterns = level.getPatterns();
+    if (patterns.size() && patterns.contains(patterns.encode(level, moved, region))) {
+        return true;
+    }
+    level.getWorkspace().resetVisited();
+    bool offGoal = false;
+    if (isFrozen(level, moved, &offGoal) && offGoal) { // no point learning what this finds anyway
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Looks for a PI-corral, cutting the pushes down to it and checking it isn't deadlocked
+ * Must be called right after the flood fill, it takes the blocks back out of the workspace
+ * and leaves h at DEAD_END if the corral can't be solved
+ *@param level the level this state is in
+ */
+void State::findCorral(Level& level) {
+    if (backward) { // corrals only cut down pushes
+        removeBlocks(level.getWorkspace());
+        return;
+    }
+    Corral& corral = level.getCorral();
+    // a corral's pushes come first in some solution with the fewest pushes, but not always in one
+    // with the fewest moves, so then the corral only checks for a deadlock
+    std::vector<unsigned char> kept;
+    unsigned char* cut = pushable();
+    if (level.countsMoves()) {
+        kept.assign(cut, cut+count);
+        cut = &kept[0];
+    }
+    int pushes = corral.find(level, cells(), count, cut);
+    removeBlocks(level.getWorkspace());
+    // the sub search needs the workspace, so it runs once the blocks are out
+    if (pushes == 0 || (pushes > 0 && corral.isDeadlocked(level, region))) {
+        h = DEAD_END;
+        // the window around the pushed block may be enough to prove it without the rest of the level
+        if (moved != -1 && !level.hasSpareBlocks()) {
+            placeBlocks(level.getWorkspace());
+            level.getPatterns().learn(level.getPatterns().encode(level, moved, region));
+            removeBlocks(level.getWorkspace());
         }
     }
 }
 
+/**
+ * Puts this state's blocks in the workspace
+ *@param workspace the workspace
+ */
+void State::placeBlocks(Workspace& workspace) {
+    unsigned short* blocks = cells();
+    for (unsigned int i = 0; i < count; i++) {
+        workspace.placeBlock(blocks[i], i);
+    }
+}
+
+/**
+ * Takes this state's blocks back out of the workspace
+ *@param workspace the workspace
+ */
+void State::removeBlocks(Workspace& workspace) {
+    unsigned short* blocks = cells();
+    for (unsigned int i = 0; i < count; i++) {
+        workspace.removeBlock(blocks[i]);
+    }
+}
+
 /**
  * Returns the states this state can change into
  *@param children (out) the child states
  *@param level the level these states are in
+ *@param pool the pool to put the children in
+ */
+void State::getChildren(std::vector<State *>* children, Level& level, NodePool& pool) {
+    // the costs are all worked out first, building a child may search walks for other states
+    std::vector<PushQueue::Push> pushes;
+    getPushes(&pushes, level);
+    for (unsigned int i = 0; i < pushes.size(); i++) {
+        State* child = new (pool.allocate()) State(this, level, pushes[i].block, pushes[i].direction, pushes[i].cost);
+        if (child->h == DEAD_END) { // never worth opening
+            pool.release(child);
+        } else {
+            children->push_back(child);
+        }
+    }
+}
+
+/**
+ * Returns the pushes this state can make without building the children
+ * Each push gets a lower bound on its child's f: one push changes the matching by at most one,
+ * and its cost, so the robot's walks are only searched once for all of them
+ *@param pushes (out) the pushes
+ *@param level the level this state is in
  */
-void State::getChildren(std::vector<State *>* children, Level& level) {
-    for (unsigned int i = 0; i < blocks.size(); i++) {
+void State::getPushes(std::vector<PushQueue::Push>* pushes, Level& level) {
+    if (h == DEAD_END) {
+        return;
+    }
+    unsigned char* pushable = this->pushable();
+    PushQueue::Push push;
+    push.parent = this;
+    int left = level.getHeuristicPushes(h);
+    push.h = level.getHeuristic(left > 0 ? left-1 : 0);
+    for (unsigned int i = 0; i < count; i++) {
+        if (!pushable[i]) {
+            continue;
+        }
+        push.block = i;
         for (int j = 0; j < 4; j++) {
-            if (!blocks[i]->isBlocked(j)) {
-                children->push_back(new State(this, level, i, j));
+            if (pushable[i] & (1 << j)) {
+                push.direction = j;
+                push.cost = getPushCost(level, i, j);
+                push.f = g+push.cost+push.h;
+                pushes->push_back(push);
             }
         }
     }
 }
 
+/**
+ * Returns what pushing a block once costs from this state, in the level's cost model
+ * Pushing a different block than the last one also pays for the robot walking over to it,
+ * as a block count, or as the exact walk when moves are counted
+ *@param level the level this state is in
+ *@param block which block (position in cells) is pushed
+ *@param direction the direction it's pushed, or pulled for a backward state
+ *@return the cost added to g
+ */
+int State::getPushCost(Level& level, unsigned int block, int direction) {
+    if (level.countsMoves()) {
+        // the robot stands behind the block to push it, or where it goes to pull it
+        int cell = level.neighbour(cells()[block], backward ? direction : direction^1);
+        return level.getCost(1, level.getWalk(this, cell)+1);
+    }
+    if (level.getCostModel() == COST_SWITCHES && moved != cells()[block]) { // switched to a different block
+        return count;
+    }
+    return 1;
+}
+
+/**
+ * Returns the cell a push takes a block to, on through a tunnel in one go,
+ * or from the goal room's entrance to the next goal of the packing order
+ *@param level the level this state is in
+ *@param block which block (position in cells) is pushed
+ *@param direction the direction it's pushed, or pulled for a backward state
+ *@param steps (out) how many cells it moves up to the goal room, NULL if not needed
+ *@param step (out) the packing step it fills, -1 if it stays short of the goal room, NULL if not needed
+ *@return the cell the child has the block on
+ */
+int State::getDestination(Level& level, unsigned int block, int direction, int* steps, int* step) {
+    int to = level.neighbour(cells()[block], direction);
+    int moves = 1;
+    // in a tunnel the robot can only push on or walk back out, so the block goes through in one go
+    while (!backward && moves < UCHAR_MAX && level.isTunnel(to, direction)) {
+        int next = level.neighbour(to, direction);
+        if (std::binary_search(cells(), cells()+count, (unsigned short)next)) {
+            break;
+        }
+        to = next;
+        moves++;
+    }
+    if (steps != NULL) {
+        *steps = moves;
+    }
+    // into the goal room the block goes on to the next goal of the packing order, while the room holds
+    // just the goals before it
+    int packing = -1;
+    if (!backward && to == level.getRoomEntrance() && direction == level.getRoomEntry()) {
+        packing = level.getPackedCount(cells(), count);
+        if (packing >= level.getPackingSize()) {
+            packing = -1;
+        }
+    }
+    if (step != NULL) {
+        *step = packing;
+    }
+    return packing != -1 ? level.getPackingGoal(packing) : to;
+}
+
+/**
+ * Returns how many blocks there are
+ *@return count
+ */
+int State::getBlockCount() {
+    return count;
+}
+
+/**
+ * Returns the cell a block is on
+ *@param block which block, in cell order
+ *@return the cell
+ */
+int State::getBlock(int block) {
+    return cells()[block];
+}
+
+/**
+ * Returns the lowest cell the robot can reach, which identifies where it is
+ *@return region
+ */
+int State::getRegion() {
+    return region;
+}
+
+/**
+ * Returns the zobrist hash of the block positions alone
+ *@return blockHash
+ */
+uint64_t State::getBlockHash() {
+    return blockHash;
+}
+
 /**
  * Returns the heuristic cost
  *@return h
@@ -172,115 +522,106 @@ int State::getF() {
  * Builds a child state from the parent
  *@param parent the parent state
  *@param level the level that this state is in
- *@param block which block was pushed to reach this state
- *@param direction the direction it was pushed
+ *@param block which block (position in cells) was pushed to reach this state
+ *@param direction the direction it was pushed, or pulled for a backward parent
+ *@param cost what the push adds to the parent's g, from getPushCost
  */
-State::State(State* _parent, Level& level, unsigned int block, int direction)/*: goals(_parent->goals)*/ {
+State::State(State* _parent, Level& level, unsigned int block, int direction, int cost)/*: goals(_parent->goals)*/ {
     parent = _parent;
-    blockPushed = block;
+    backward = parent->backward;
     pushDirection = direction;
-
-    width = parent->width;
-
-    // build state representation
-    //wall_map = parent->wall_map;
-    value = level.getWallMap();//*wall_map;
-
-    // place the robot where the block was
-    value[parent->blocks[block]->getX()+parent->blocks[block]->getY()*width] = ROBOT;
-
-    // place the blocks, make sure to move one
-    for (unsigned int i = 0; i < parent->blocks.size(); i++) {
-        int index = parent->blocks[i]->getX()+parent->blocks[i]->getY()*width;
-        if (i == block) {
-            switch (direction) {
-                case UP:
-                    index -= width;
-                    break;
-                case DOWN:
-                    index += width;
-                    break;
-                case LEFT:
-                    index--;
-                    break;
-                case RIGHT:
-                    index++;
-                    break;
-            }
-        }
-        value[index] = BLOCK;
-        blocks.push_back(new Block(index%width, index/width));
-        blocksPos[index] = blocks[i];
+    openIndex = -1;
+    packed = false;
+
+    // the robot ends up where the block was, or steps back past it after a pull
+    int from = parent->cells()[block];
+    int moves;
+    int step;
+    moved = parent->getDestination(level, block, direction, &moves, &step);
+    steps = moves;
+    int robot = backward ? level.neighbour(moved, direction) : level.neighbour(moved, direction^1);
+    int pushes = steps;
+    int walked = 0;
+    if (step != -1) { // the packing path takes the block on from the entrance
+        packed = true;
+        robot = level.getPackingCells(step).back();
+        pushes += level.getPackingCells(step).size();
+        walked = level.getPackingWalk(step);
     }
-
-    for (unsigned int i = 0; i < level.getGoals().size(); i++) {
-        int index =  level.getGoals()[i]->getX()+ level.getGoals()[i]->getY()*width;
-        if (value[index] == ROBOT) {
-            value[index] = ROBOT_ON_GOAL;
-        } else if (value[index] == BLOCK) {
-            value[index] = BLOCK_ON_GOAL;
-        } else {
-            value[index] = GOAL;
-        }
+    region = robot;
+    blockHash = parent->blockHash^level.getBlockHash(from)^level.getBlockHash(moved);
+
+    // move the block, shifting it along to keep the cells sorted, its goal goes with it
+    count = parent->count;
+    unsigned short* blocks = cells();
+    unsigned short* goals = assignment();
+    memcpy(blocks, parent->cells(), count*sizeof(unsigned short));
+    memcpy(goals, parent->assignment(), count*sizeof(unsigned short));
+    unsigned short goal = goals[block];
+    unsigned int i = block;
+    while (i > 0 && blocks[i-1] > moved) {
+        blocks[i] = blocks[i-1];
+        goals[i] = goals[i-1];
+        i--;
     }
+    while (i+1 < count && blocks[i+1] < moved) {
+        blocks[i] = blocks[i+1];
+        goals[i] = goals[i+1];
+        i++;
+    }
+    blocks[i] = moved;
+    goals[i] = goal;
+    memset(pushable(), 0, count);
 
-    //printf("parent[%d,%d] => me[%d,%d]\n", parent->blockPushed, parent->pushDirection, block, direction);
+    //printf("parent[%d,%d] => me[%d,%d]\n", parent->moved, parent->pushDirection, from, direction);
 
-    g = parent->g+1;
-    //g = parent->g;
-    if (parent->blockPushed != blockPushed) {
-        g += blocks.size()-1;
-    }
-    /*if (parent->parent == NULL) { // parent is start state
-        level.pathTo(block, direction, level.getRobot()->getX(), level.getRobot()->getY(), &(parent->blocks));
-    } else {
-        level.pathTo(block, direction, parent->parent->blocks[parent->blockPushed]->getX(), parent->parent->blocks[parent->blockPushed]->getY(), &(parent->blocks));
-    }
-    g = parent->g+parent->blocks[block]->getPath(direction).size();*/
-    evaluate(level.getGoals());
+    // the pushes on through a tunnel or the room are the same block, the robot only walks in the room
+    g = parent->g+cost+level.getCost(pushes-1, pushes-1+walked);
 
-    if (h) {
-        floodFill(parent->blocks[block]->getX(), parent->blocks[block]->getY());
+    Workspace& workspace = level.getWorkspace();
+    placeBlocks(workspace);
+    // pulling back from the goals never freezes a block that still has to get anywhere
+    if (!backward && isDeadlocked(level)) {
+        h = DEAD_END;
+        removeBlocks(workspace);
+    } else {
+        evaluate(level, i, level.getHeuristicPushes(parent->h)-level.getMatching().getCost(level, from, goal));
+        if (h != DEAD_END && (h || backward)) {
+            floodFill(level, robot);
+            findCorral(level);
+        } else {
+            removeBlocks(workspace);
+        }
     }
+    hash = blockHash^level.getRobotHash(region);
 }
 
 /**
  * Evaluates (calculates h) how good this state is
- * heuristic = manhatten distance
- *@param goals the goals we want to cover
- */
-void State::evaluate(std::vector<Goal *>& goals) {
-    h = 0;
-    // blocks can be re-counted, we just care how close a block is to this goal
-    for (unsigned int i = 0; i < goals.size(); i++) {
-        for (unsigned int j = 0; j < blocks.size(); j++) {
-            if (std::abs(blocks[j]->getX()-goals[i]->getX())+std::abs(blocks[j]->getY()-goals[i]->getY()) == 0) {
-                blocks[j]->setOnGoal(i);
-            }
-        }
+ * heuristic = pushes of the cheapest matching of blocks to goals, DEAD_END if there is none
+ *@param level the level with the goals we want to cover
+ */
+void State::evaluate(Level& level) {
+    h = level.getMatching().solve(level, cells(), count, assignment());
+    if (h == -1) { // some goal can't get a block of its own
+        h = DEAD_END;
+    } else {
+        h = level.getHeuristic(h);
     }
+}
 
-    for (unsigned int i = 0; i < goals.size(); i++) {
-        int distance = -1;
-        int blockJ = -1;
-        for (unsigned int j = 0; j < blocks.size(); j++) {
-            if (blocks[j]->getGoal() == (signed)i) {
-                distance = 0;
-                break;
-            } else if (blocks[j]->getGoal() == -1) {
-                int new_distance = std::abs(blocks[j]->getX()-goals[i]->getX())+std::abs(blocks[j]->getY()-goals[i]->getY());
-                if (distance == -1 || new_distance < distance) {
-                    distance = new_distance;
-                    blockJ = i;
-                    if (distance == 0) { // can't get better than this
-                        break;
-                    }
-                }
-            }
-        }
-        //if (distance != 0) {
-            h += distance;//+1;
-        //}
+/**
+ * Evaluates (calculates h) a child from its parent's matching, only one block moved
+ *@param level the level with the goals we want to cover
+ *@param block which block (position in cells) was pushed
+ *@param cost the pushes of the parent's matching without the pushed block's part
+ */
+void State::evaluate(Level& level, unsigned int block, int cost) {
+    h = level.getMatching().repair(level, cells(), count, assignment(), block, cost);
+    if (h == -1) {
+        h = DEAD_END;
+    } else {
+        h = level.getHeuristic(h);
     }
 }
 
@@ -293,35 +634,78 @@ State* State::getParent() {
 }
 
 /**
- * Returns the block that was pushed to get this state
- *@return blockPushed
+ * Returns the cell the pushed block was on before the push
+ * For a backward state it's the push undoing the pull, from this state to its parent
+ *@param level the level this state is in
+ *@return the cell the block is pushed from, -1 for the start state
  */
-int State::getBlockPushedIndex() {
-    return blockPushed;
+int State::getPushedCell(Level& level) {
+    if (parent == NULL) {
+        return -1;
+    }
+    if (backward) {
+        return moved;
+    }
+    int cell = packed ? level.getRoomEntrance() : moved;
+    for (int i = 0; i < steps; i++) {
+        cell = level.neighbour(cell, pushDirection^1); // UP^1 == DOWN, LEFT^1 == RIGHT
+    }
+    return cell;
 }
 
-/**
- * Returns the path to reach the side of the block to push it
- *@return the path to the block
- */
-/*std::vector<int>& State::getBlockPushedPath() {
-    return parent->blocks[blockPushed]->getPath(pushDirection);
-}*/
-
 /**
  * Returns the direction that block was pushed
- *@return pushDirection
+ * For a backward state it's the push undoing the pull, from this state to its parent
+ *@return the push direction
  */
 int State::getPushDirection() {
+    if (backward) {
+        return pushDirection^1;
+    }
     return pushDirection;
 }
 
+/**
+ * Returns how many cells the block moved to reach this state, it's pushed through tunnels at once
+ *@return the pushes, 0 for the start state
+ */
+int State::getSteps() {
+    return steps;
+}
+
+/**
+ * Returns the cell the block that moved last ended up on
+ *@return the cell, -1 for the start state
+ */
+int State::getMoved() {
+    return moved;
+}
+
+/**
+ * Returns whether or not the push into the goal room went on to the next goal in the packing order
+ *@return true if the block was packed
+ */
+bool State::isPacked() {
+    return packed;
+}
+
 /**
  * Prints this state
+ *@param level the level this state is in
  */
-void State::print() {
-    for (unsigned int i = 0; i < value.size(); i++) {
-        printf("%c", value[i]);
+void State::print(Level& level) {
+    std::string board = level.getWallMap();
+    int width = level.getWidth();
+    for (unsigned int i = 0; i < level.getGoals().size(); i++) {
+        board[level.getGoals()[i]->getX()+level.getGoals()[i]->getY()*width] = GOAL;
+    }
+    unsigned short* blocks = cells();
+    for (unsigned int i = 0; i < count; i++) {
+        board[blocks[i]] = board[blocks[i]] == GOAL ? BLOCK_ON_GOAL : BLOCK;
+    }
+    board[region] = board[region] == GOAL ? ROBOT_ON_GOAL : ROBOT;
+    for (unsigned int i = 0; i < board.size(); i++) {
+        printf("%c", board[i]);
         if (!((i+1)%width)) {
             printf("\n");
         }
@@ -0,0 +1,134 @@
+#include "transpositiontable.h"
+#include "state.h"
+#include <cstddef>
+
+#define INITIAL_SLOTS 1024
+
+/**
+ * Inits an empty table
+ */
+TranspositionTable::TranspositionTable() {
+    slots.assign(INITIAL_SLOTS, NULL);
+    mask = INITIAL_SLOTS-1;
+    count = 0;
+}
+
+/**
+ * Finds the stored copy of a state
+ *@param state the state to look for
+ *@return the stored state, NULL if it hasn't been seen
+ */
+State* TranspositionTable::find(State* state) {
+    return slots[probe(state)];
+}
+
+/**
+ * Adds a state that isn't in the table yet
+ *@param state the state to add
+ */
+void TranspositionTable::insert(State* state) {
+    // keep the load under 1/2 so probe chains stay short
+    if ((count+1)*2 > slots.size()) {
+        grow();
+    }
+    slots[probe(state)] = state;
+    count++;
+}
+
+/**
+ * Swaps the stored copy of a state for another copy
+ *@param old the stored state
+ *@param replacement the state to store in its place
+ */
+void TranspositionTable::replace(State* old, State* replacement) {
+    slots[probe(old)] = replacement;
+}
+
+/**
+ * Takes a stored state out of the table, without freeing it
+ *@param state the stored state
+ */
+void TranspositionTable::remove(State* state) {
+    unsigned int hole = probe(state);
+    if (slots[hole] == NULL) {
+        return;
+    }
+    slots[hole] = NULL;
+    count--;
+    // pull the rest of the probe chain back over the hole, so nothing after it goes missing,
+    // a state only moves if its own slot isn't between the hole and where it is now
+    for (unsigned int index = (hole+1) & mask; slots[index] != NULL; index = (index+1) & mask) {
+        unsigned int home = (unsigned int)slots[index]->getHash() & mask;
+        if (((index-home) & mask) >= ((index-hole) & mask)) {
+            slots[hole] = slots[index];
+            slots[index] = NULL;
+            hole = index;
+        }
+    }
+}
+
+/**
+ * Returns how many states are stored
+ *@return size
+ */
+unsigned int TranspositionTable::size() {
+    return count;
+}
+
+/**
+ * Returns how many slots the table has
+ *@return the slot count
+ */
+unsigned int TranspositionTable::capacity() {
+    return slots.size();
+}
+
+/**
+ * Returns the state in a slot
+ *@param index the slot
+ *@return the state, NULL if the slot is empty
+ */
+State* TranspositionTable::at(unsigned int index) {
+    return slots[index];
+}
+
+/**
+ * Empties the table without freeing the states
+ */
+void TranspositionTable::clear() {
+    slots.assign(INITIAL_SLOTS, NULL);
+    mask = INITIAL_SLOTS-1;
+    count = 0;
+}
+
+/**
+ * Returns the slot holding a state, or the empty slot it belongs in
+ *@param state the state to look for
+ *@return the slot index
+ */
+unsigned int TranspositionTable::probe(State* state) {
+    // zobrist hashes are already uniformly random, the low bits make a fine index
+    unsigned int index = (unsigned int)state->getHash() & mask;
+    while (slots[index] != NULL) {
+        if (slots[index]->getHash() == state->getHash() && slots[index]->sameAs(state)) {
+            break;
+        }
+        index = (index+1) & mask;
+    }
+    return index;
+}
+
+/**
+ * Doubles the slot count and reinserts every state
+ */
+void TranspositionTable::grow() {
+    std::vector<State *> old;
+    old.swap(slots);
+    slots.assign(old.size()*2, NULL);
+    mask = slots.size()-1;
+    for (unsigned int i = 0; i < old.size(); i++) {
+        if (old[i] != NULL) {
+            slots[probe(old[i])] = old[i];
+        }
+    }
+}
@@ -0,0 +1,301 @@
+#include "workspace.h"
+#include "constants.h"
+
+#define BITS 64 /**< cells per bitboard word */
+
+/**
+ * Inits an empty workspace
+ */
+Workspace::Workspace() {
+    stamp = 1;
+}
+
+/**
+ * Sizes the grids for a level
+ *@param _width the map width
+ *@param height the map height
+ *@param walls the wall map
+ *@param dead 1 for cells a block must never be pushed onto
+ */
+void Workspace::resize(int _width, int height, std::string& walls, std::vector<char>& dead) {
+    blocks.assign(walls.size(), -1);
+    visited.assign(walls.size(), 0);
+    stamp = 1;
+
+    width = _width;
+    rows = height;
+    words = (width+BITS-1)/BITS;
+    floor.assign(rows*words, 0);
+    targets.assign(rows*words, 0);
+    blockBits.assign(rows*words, 0);
+    reached.assign(rows*words, 0);
+    for (int i = 0; i < (int)walls.size() && i < width*rows; i++) {
+        int word = i/width*words+i%width/BITS;
+        uint64_t bit = 1ULL << (i%width%BITS);
+        if (walls[i] != WALL) {
+            floor[word] |= bit;
+            if (!dead[i]) {
+                targets[word] |= bit;
+            }
+        }
+    }
+}
+
+/**
+ * Marks a cell as holding a block
+ *@param index the cell
+ *@param block which block is there
+ */
+void Workspace::placeBlock(int index, int block) {
+    blocks[index] = block;
+    blockBits[index/width*words+index%width/BITS] |= 1ULL << (index%width%BITS);
+}
+
+/**
+ * Marks a cell as not holding a block
+ *@param index the cell
+ */
+void Workspace::removeBlock(int index) {
+    blocks[index] = -1;
+    blockBits[index/width*words+index%width/BITS] &= ~(1ULL << (index%width%BITS));
+}
+
+/**
+ * Returns the block on a cell
+ *@param index the cell
+ *@return the block, -1 if there is none
+ */
+int Workspace::getBlock(int index) {
+    return blocks[index];
+}
+
+/**
+ * Forgets every visited cell
+ */
+void Workspace::resetVisited() {
+    stamp++;
+    if (stamp == 0) { // wrapped around, old stamps could look current
+        visited.assign(visited.size(), 0);
+        stamp = 1;
+    }
+}
+
+/**
+ * Marks a cell as visited
+ *@param index the cell
+ */
+void Workspace::visit(int index) {
+    visited[index] = stamp;
+}
+
+/**
+ * Marks a cell as not visited
+ *@param index the cell
+ */
+void Workspace::unvisit(int index) {
+    visited[index] = 0;
+}
+
+/**
+ * Returns whether or not a cell was visited since the last reset
+ *@param index the cell
+ *@return true if visited
+ */
+bool Workspace::isVisited(int index) {
+    return visited[index] == stamp;
+}
+
+/**
+ * Finds every cell the robot can walk to around the placed blocks
+ *@param start the robot's cell
+ *@return the lowest cell it can reach
+ */
+int Workspace::reach(int start) {
+    for (unsigned int i = 0; i < reached.size(); i++) {
+        reached[i] = 0;
+    }
+    int startRow = start/width;
+    reached[startRow*words+start%width/BITS] = 1ULL << (start%width%BITS);
+    fillRow(startRow*words);
+
+    // sweep down then up, each row taking in what the row before it reached, until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int pass = 0; pass < 2; pass++) {
+            int first = pass ? rows-2 : 1;
+            int last = pass ? -1 : rows;
+            int step = pass ? -1 : 1;
+            for (int y = first; y != last; y += step) {
+                int row = y*words;
+                int before = (y-step)*words;
+                bool grew = false;
+                for (int w = 0; w < words; w++) {
+                    uint64_t in = reached[before+w] & floor[row+w] & ~blockBits[row+w] & ~reached[row+w];
+                    if (in) {
+                        reached[row+w] |= in;
+                        grew = true;
+                    }
+                }
+                if (grew) {
+                    fillRow(row);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < rows*words; i++) {
+        if (reached[i]) {
+            return i/words*width+i%words*BITS+__builtin_ctzll(reached[i]);
+        }
+    }
+    return start;
+}
+
+/**
+ * Returns whether or not the robot reached a cell in the last reach
+ *@param index the cell
+ *@return true if it can walk there
+ */
+bool Workspace::isReached(int index) {
+    return reached[index/width*words+index%width/BITS] >> (index%width%BITS) & 1;
+}
+
+/**
+ * Finds the pushes the robot can make from the cells it reached,
+ * onto cells that are free and not dead
+ *@param pushable (out) a bit per direction for each block, indexed like the placed blocks
+ */
+void Workspace::findPushes(unsigned char* pushable) {
+    for (int y = 0; y < rows; y++) {
+        int row = y*words;
+        for (int w = 0; w < words; w++) {
+            int i = row+w;
+            uint64_t here = blockBits[i];
+            if (!here) {
+                continue;
+            }
+            int cell = y*width+w*BITS;
+            uint64_t free = targets[i] & ~blockBits[i];
+            // the cells one to the left and right, carrying across the words of the row
+            uint64_t reachedLeft = reached[i] << 1 | (w > 0 ? reached[i-1] >> (BITS-1) : 0);
+            uint64_t reachedRight = reached[i] >> 1 | (w+1 < words ? reached[i+1] << (BITS-1) : 0);
+            uint64_t freeLeft = free << 1 | (w > 0 ? (targets[i-1] & ~blockBits[i-1]) >> (BITS-1) : 0);
+            uint64_t freeRight = free >> 1 | (w+1 < words ? (targets[i+1] & ~blockBits[i+1]) << (BITS-1) : 0);
+            addPushes(here & reachedLeft & freeRight, cell, RIGHT, pushable);
+            addPushes(here & reachedRight & freeLeft, cell, LEFT, pushable);
+            if (y > 0 && y+1 < rows) {
+                uint64_t freeUp = targets[i-words] & ~blockBits[i-words];
+                uint64_t freeDown = targets[i+words] & ~blockBits[i+words];
+                addPushes(here & reached[i-words] & freeDown, cell, DOWN, pushable);
+                addPushes(here & reached[i+words] & freeUp, cell, UP, pushable);
+            }
+        }
+    }
+}
+
+/**
+ * Finds the pulls the robot can make from the cells it reached, each moving a block
+ * onto a cell that is not dead with the robot stepping back onto the free cell past it
+ *@param pullable (out) a bit per direction the block moves for each block, indexed like the placed blocks
+ */
+void Workspace::findPulls(unsigned char* pullable) {
+    for (int y = 0; y < rows; y++) {
+        int row = y*words;
+        for (int w = 0; w < words; w++) {
+            int i = row+w;
+            uint64_t here = blockBits[i];
+            if (!here) {
+                continue;
+            }
+            int cell = y*width+w*BITS;
+            // the robot stands on the reached cell next to the block, which the block moves onto
+            uint64_t right = along(reached, i, w, 1) & along(targets, i, w, 1) & along(floor, i, w, 2) & ~along(blockBits, i, w, 2);
+            uint64_t left = along(reached, i, w, -1) & along(targets, i, w, -1) & along(floor, i, w, -2) & ~along(blockBits, i, w, -2);
+            addPushes(here & right, cell, RIGHT, pullable);
+            addPushes(here & left, cell, LEFT, pullable);
+            if (y+2 < rows) {
+                addPushes(here & reached[i+words] & targets[i+words] & floor[i+2*words] & ~blockBits[i+2*words], cell, DOWN, pullable);
+            }
+            if (y >= 2) {
+                addPushes(here & reached[i-words] & targets[i-words] & floor[i-2*words] & ~blockBits[i-2*words], cell, UP, pullable);
+            }
+        }
+    }
+}
+
+/**
+ * Returns a word of a bitboard moved along its row, carrying across the words of the row
+ *@param bits the bitboard
+ *@param i the word
+ *@param w the word's place in its row
+ *@param by how many cells to the right to look, negative to look left, at most 63
+ *@return bit x is the cell by cells to the right of the word's cell x
+ */
+uint64_t Workspace::along(std::vector<uint64_t>& bits, int i, int w, int by) {
+    if (by > 0) {
+        return bits[i] >> by | (w+1 < words ? bits[i+1] << (BITS-by) : 0);
+    }
+    return bits[i] << -by | (w > 0 ? bits[i-1] >> (BITS+by) : 0);
+}
+
+/**
+ * Spreads the reached cells of a row along the free cells of the row
+ *@param row the first word of the row
+ */
+void Workspace::fillRow(int row) {
+    // doubling fill to the right then to the left in each word, carrying into the next word
+    uint64_t carry = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t open = floor[row+w] & ~blockBits[row+w];
+        uint64_t fill = (reached[row+w] | carry) & open;
+        uint64_t through = open;
+        fill |= through & (fill << 1);
+        through &= through << 1;
+        fill |= through & (fill << 2);
+        through &= through << 2;
+        fill |= through & (fill << 4);
+        through &= through << 4;
+        fill |= through & (fill << 8);
+        through &= through << 8;
+        fill |= through & (fill << 16);
+        through &= through << 16;
+        fill |= through & (fill << 32);
+        reached[row+w] = fill;
+        carry = fill >> (BITS-1);
+    }
+    carry = 0;
+    for (int w = words-1; w >= 0; w--) {
+        uint64_t open = floor[row+w] & ~blockBits[row+w];
+        uint64_t fill = (reached[row+w] | carry) & open;
+        uint64_t through = open;
+        fill |= through & (fill >> 1);
+        through &= through >> 1;
+        fill |= through & (fill >> 2);
+        through &= through >> 2;
+        fill |= through & (fill >> 4);
+        through &= through >> 4;
+        fill |= through & (fill >> 8);
+        through &= through >> 8;
+        fill |= through & (fill >> 16);
+        through &= through >> 16;
+        fill |= through & (fill >> 32);
+        reached[row+w] = fill;
+        carry = fill << (BITS-1);
+    }
+}
+
+/**
+ * Marks the blocks on the set bits of a word as pushable in a direction
+ *@param bits the word
+ *@param cell the cell of the word's first bit
+ *@param direction the push direction
+ *@param pushable (out) the pushes per block
+ */
+void Workspace::addPushes(uint64_t bits, int cell, int direction, unsigned char* pushable) {
+    while (bits) {
+        pushable[blocks[cell+__builtin_ctzll(bits)]] |= 1 << direction;
+        bits &= bits-1;
+    }
+}